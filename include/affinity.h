@@ -0,0 +1,41 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <pthread.h>
+
+/* Placement of the decoding threads on the CPUs */
+enum affinity_policy {
+    /* Left to the system */
+    AFFINITY_NONE,
+    /* All the hardware threads of a core before the next core */
+    AFFINITY_COMPACT,
+    /* One hardware thread of each core (alternating the packages) before the
+     * SMT siblings */
+    AFFINITY_SCATTER,
+    AFFINITY_POLICIES
+};
+
+extern const char *const affinity_names[AFFINITY_POLICIES];
+
+int affinity_parse(const char *name);
+int affinity_cpus(enum affinity_policy policy, int *cpus, int size);
+int affinity_set(pthread_attr_t *attr, int cpu);
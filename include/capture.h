@@ -0,0 +1,78 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "param.h"
+
+/* Version of the format of the capture files, to be incremented on each
+ * incompatible change. */
+#define CAPTURE_VERSION 1
+
+/* Number of records buffered for each thread (power of two) */
+#define CAPTURE_RING 256
+
+/* Instance as stored in a capture file: the parity check matrix, the error
+ * pattern and (for Ouroboros) the error pattern on the syndrome, as sparse
+ * vectors. */
+struct capture_record {
+    /* Number of the key in per-key mode (-1 otherwise) and of the instance
+     * (see decoding_results_t) */
+    int64_t key;
+    int64_t index;
+    /* Number of iterations, -1 for a failure */
+    int32_t iter;
+    uint32_t reserved;
+    /* Weight of the instance (importance sampling, stratified sampling) */
+    double weight;
+    uint32_t columns[INDEX][BLOCK_WEIGHT];
+    uint32_t error[ERROR_WEIGHT];
+#if OUROBOROS
+    uint32_t syndrome_error[SYNDROME_STOP];
+#endif
+};
+
+struct capture;
+
+/* Capture file mapped in memory to decode its instances again, shared by all
+ * the threads */
+struct corpus {
+    const struct capture_record *records;
+    long int count;
+    void *map;
+    size_t size;
+};
+
+struct capture *capture_open(const char *filename, const char *params,
+                             int n_threads);
+struct capture *capture_open_records(const char *filename,
+                                     const char file_magic[8],
+                                     uint32_t version, const char *params,
+                                     size_t record_size,
+                                     unsigned long ring_size, int n_threads);
+struct capture_record *capture_reserve(struct capture *c, int tid);
+void *capture_reserve_record(struct capture *c, int tid);
+void capture_commit(struct capture *c, int tid);
+int capture_close(struct capture *c, long int *written, long int *dropped);
+int corpus_open(const char *filename, const char *params, struct corpus *c);
+void corpus_close(struct corpus *c);
@@ -0,0 +1,79 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stdint.h>
+
+/* Version of the format of the result files, to be incremented on each
+ * incompatible change. */
+#define CHECKPOINT_VERSION 5
+
+/* Instances first + shard_index + n * shard_count for n < next, with the
+ * randomness derived from 'seed' (see decoding_results_t) */
+struct campaign {
+    uint64_t seed;
+    long int first;
+    long int shard_index;
+    long int shard_count;
+    long int next;
+};
+
+/* Results of a simulation, as stored in a result file. */
+struct checkpoint {
+    /* Compilation parameters, as printed on the first line of the output */
+    char *params;
+    int max_iter;
+    /* Errors decoded by key in per-key mode (the indices are then those of the
+     * keys), 0 otherwise */
+    long int key_errors;
+    long int n_test;
+    long int n_success;
+    long int *n_iter;
+    /* Final state of the failures and latencies (see decoding_results_t),
+     * the lengths of the histograms depend on the parameters */
+    long int syndrome_length;
+    long int error_length;
+    long int fail_blocked;
+    long int *fail_syndrome;
+    long int *fail_error;
+    long int *fail_stall;
+    long int *latency;
+    /* Campaign of the results (see decoding_results_t), shard_count is zero
+     * for merged results */
+    uint64_t seed;
+    long int first;
+    long int shard_index;
+    long int shard_count;
+    /* Number of instances of the shard whose results are included, all the
+     * ones before were decoded */
+    long int next;
+    /* Merged results: the campaigns of the results they sum */
+    long int n_campaigns;
+    struct campaign *campaigns;
+};
+
+void checkpoint_init(struct checkpoint *cp, const char *params, int max_iter);
+void checkpoint_init_from(struct checkpoint *cp, const struct checkpoint *src);
+void checkpoint_clear(struct checkpoint *cp);
+int checkpoint_save(const char *filename, const struct checkpoint *cp);
+int checkpoint_load(const char *filename, struct checkpoint *cp);
+void checkpoint_add(struct checkpoint *dst, const struct checkpoint *src);
+int checkpoint_merge(struct checkpoint *dst, const struct checkpoint *src);
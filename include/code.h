@@ -26,6 +26,8 @@
 void transpose_columns(code_t *H);
 void transpose_rows(code_t *H);
 
+void compute_key_data(key_data_t *key);
+
 void compute_codeword(cw_t codeword, code_t *H, msg_t message);
 void compute_syndrome(syndrome_t *syndrome, code_t *H, e_t *e_dense);
 void compute_counters(counters_t counters, bit_t *syndrome, code_t *H);
@@ -24,9 +24,14 @@
 #include "xoshiro256plusplus.h"
 
 void init_decoder(decoder_t dec, code_t *H, e_t *e, syndrome_t *syndrome);
+void init_decoder_key(decoder_t dec, key_data_t *key, e_t *e,
+                      syndrome_t *syndrome);
 void reset_decoder(decoder_t dec);
+bit_t get_counter(decoder_t dec, index_t index, index_t position);
+void flip_column(decoder_t dec, index_t index, index_t position);
 #if (ALGO == SBS) || (ALGO == SORT)
 int qcmdpc_decode(decoder_t dec, int max_iter, prng_t prng);
+void decoder_reseed(decoder_t dec, prng_t prng);
 #else
 int qcmdpc_decode(decoder_t dec, int max_iter);
 #endif
@@ -0,0 +1,31 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include "types.h"
+
+void init_decoder_batch(decoder_batch_t dec, code_t *H);
+void reset_decoder_batch(decoder_batch_t dec);
+void batch_add_error(decoder_batch_t dec, index_t lane,
+                     const sparse_t e_sparse);
+void batch_add_syndrome_error(decoder_batch_t dec, index_t lane,
+                              const sparse_t e_sparse, index_t weight);
+lane_mask_t qcmdpc_decode_batch(decoder_batch_t dec, int max_iter);
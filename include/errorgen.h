@@ -32,3 +32,24 @@ void generate_around_word(sparse_t e_dst, index_t weight_dst, sparse_t e_src,
 void generate_near_codeword(sparse_t e_block, code_t *H, prng_t prng);
 void generate_near_codeword2(sparse_t e_block, code_t *H, prng_t prng);
 void generate_codeword(sparse_t e_block, code_t *H, prng_t prng);
+
+/* Largest possible intersection of an error pattern with a column */
+#define TILT_MAX                                                               \
+    ((BLOCK_WEIGHT < ERROR_WEIGHT) ? BLOCK_WEIGHT : ERROR_WEIGHT)
+
+/* Importance sampling: the intersection l of the error pattern with a random
+ * column of the parity check matrix follows the hypergeometric distribution
+ * tilted by exp(theta * l). */
+typedef struct tilt {
+    double theta;
+    /* Log of the expectation of exp(theta * l) for a random error pattern */
+    double log_z;
+    /* exp(theta * l - log_z) */
+    double ratio[TILT_MAX + 1];
+    /* Cumulative distribution function of the tilted distribution */
+    double cdf[TILT_MAX + 1];
+} tilt_t;
+
+void init_tilt(tilt_t *tilt, double theta);
+double generate_tilted_error(sparse_t e_block, code_t *H, const tilt_t *tilt,
+                             prng_t prng);
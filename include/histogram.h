@@ -0,0 +1,63 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stdint.h>
+
+#include "capture.h"
+#include "param.h"
+
+/* Version of the format of the counter files, to be incremented on each
+ * incompatible change. */
+#define HISTOGRAM_VERSION 1
+
+/* Number of records buffered for each thread (power of two) */
+#define HISTOGRAM_RING 4096
+
+/* Distributions of the counters of the positions in and out of the remaining
+ * error, each time all the counters are computed, as stored in a counter file
+ * (with the header of the capture files, see capture.c, and the magic
+ * "QCMDPCH"). They are the empirical counterparts of the binomial
+ * distributions of the threshold model (see threshold.c). */
+struct histogram_record {
+    /* Number of the instance (see decoding_results_t) */
+    int64_t index;
+    /* Number of iterations so far */
+    int32_t iter;
+    uint32_t syndrome_weight;
+    /* Weight of the remaining error */
+    uint32_t e_weight;
+    uint32_t reserved;
+    /* Number of positions by counter value */
+    uint32_t in_error[BLOCK_WEIGHT + 1];
+    uint32_t out_error[BLOCK_WEIGHT + 1];
+};
+
+/* Counters of the instance decoded by a thread, set in its decoder when the
+ * instance is sampled */
+struct histogram_target {
+    struct capture *c;
+    int tid;
+    long int index;
+};
+
+struct capture *histogram_open(const char *filename, const char *params,
+                               int n_threads);
@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include "types.h"
+
+/* Kernels generated at runtime for a given key: the offsets of the parity
+ * check matrix are encoded as displacements of the instructions instead of
+ * being loaded from memory. */
+
+/* Counters of all the positions of a block, 'syndrome' is mirrored. */
+typedef void (*jit_counters_t)(bit_t *counters, const bit_t *syndrome);
+/* Counter of a single position, 'syndrome' points to the position and 'split'
+ * is the number of offsets that do not wrap around from it. */
+typedef bit_t (*jit_counter_t)(const bit_t *syndrome, index_t split);
+/* Flip the syndrome bits of a single column, same arguments. */
+typedef void (*jit_flip_t)(bit_t *syndrome, index_t split);
+
+struct jit {
+    uint8_t *code;
+    size_t size;
+    jit_counters_t counters[INDEX];
+    jit_counter_t counter[INDEX];
+    jit_flip_t flip[INDEX];
+};
+
+struct jit *jit_alloc(void);
+void jit_free(struct jit *jit);
+int jit_compile(struct jit *jit, const code_t *H);
+#ifdef AVX
+void jit_compute_counters(const struct jit *jit, counters_t counters,
+                          bit_t *syndrome);
+#endif
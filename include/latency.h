@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stdint.h>
+
+/* Latencies (in cycles of the timestamp counter, see profile_clock) are
+ * counted in buckets of logarithmic width: values below LATENCY_SUB have their
+ * own bucket, larger ones share a bucket with the values having the same
+ * LATENCY_SUB_BITS + 1 most significant bits, which bounds the relative
+ * error by 1 / LATENCY_SUB. */
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB)
+
+/* Latencies measured for each decoded instance */
+enum latency_kind {
+    /* Generation of the instance (without the key in per-key mode) up to the
+     * syndrome */
+    LATENCY_SETUP,
+    /* Call to the decoder, by outcome */
+    LATENCY_SUCCESS,
+    LATENCY_FAILURE,
+    LATENCY_KINDS
+};
+
+static inline int latency_bucket(uint64_t cycles) {
+    if (cycles < LATENCY_SUB)
+        return cycles;
+    int e = 63 - __builtin_clzll(cycles);
+    return ((e - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) +
+           ((cycles >> (e - LATENCY_SUB_BITS)) & (LATENCY_SUB - 1));
+}
+
+/* Smallest latency of bucket 'b' (the largest is latency_lower(b + 1) - 1) */
+static inline uint64_t latency_lower(int b) {
+    if (b < LATENCY_SUB)
+        return b;
+    int e = (b >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+    return (uint64_t)(LATENCY_SUB + (b & (LATENCY_SUB - 1)))
+           << (e - LATENCY_SUB_BITS);
+}
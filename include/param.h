@@ -273,6 +273,24 @@
 #define ALGO GRAY_BGF
 #endif
 
+#ifndef BATCH
+#define BATCH 0
+#endif
+
+/* Account the time spent in each phase of the simulation */
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+/* Also count hardware events in each phase (implies PROFILE) */
+#ifndef PERF
+#define PERF 0
+#endif
+#if PERF && !PROFILE
+#undef PROFILE
+#define PROFILE 1
+#endif
+
 #ifndef BP_SCALE
 #define BP_SCALE 0.4
 #endif
@@ -332,3 +350,13 @@
 #if ALGO == BP && OUROBOROS
 #error "Ouroboros with belief propagation decoding: Not implemented"
 #endif
+#if BATCH && (ALGO != GRAY_BGF) && (ALGO != GRAY_BGB) && (ALGO != GRAY_B) &&   \
+    (ALGO != GRAY_BG)
+#error "BATCH with another algorithm than GRAY_*: Not implemented"
+#endif
+#if PERF && !defined(__linux__)
+#error "PERF on another system than Linux: Not implemented"
+#endif
+#if defined(JIT) && !defined(__x86_64__)
+#error "JIT on another architecture than x86-64: Not implemented"
+#endif
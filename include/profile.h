@@ -0,0 +1,153 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "param.h"
+
+/* Phases of the simulation, timed when built with PROFILE */
+enum profile_phase {
+    /* Generation of the parity check matrices */
+    PROFILE_KEYGEN,
+    /* Generation of the error patterns */
+    PROFILE_ERRORGEN,
+    /* Conversion of the error patterns to dense vectors */
+    PROFILE_DENSE,
+    /* Syndromes of the error patterns (and of the decisions for BP) */
+    PROFILE_SYNDROME,
+    PROFILE_THRESHOLD,
+    /* All the counters at once */
+    PROFILE_COUNTERS,
+    /* Loops selecting and flipping positions (with the counters of single
+     * positions) */
+    PROFILE_FLIPS,
+    /* Message passing of belief propagation */
+    PROFILE_BP,
+    /* Whole time of the threads, from their start to their last instance */
+    PROFILE_TOTAL,
+    PROFILE_PHASES
+};
+
+extern const char *const profile_names[PROFILE_PHASES];
+
+/* Hardware events counted in each phase when built with PERF */
+enum profile_event {
+    PERF_INSTRUCTIONS,
+    PERF_CYCLES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENTS
+};
+
+extern const char *const perf_names[PERF_EVENTS];
+
+/* Time spent by a thread in each phase (in cycles of the timestamp counter,
+ * in nanoseconds where there is none) and number of times it was entered
+ * (number of instances for PROFILE_TOTAL). Only written by the thread. */
+struct profile {
+    _Atomic uint64_t cycles[PROFILE_PHASES];
+    _Atomic uint64_t count[PROFILE_PHASES];
+#if PERF
+    /* Hardware events in each phase, 'perf' is set if they were counted */
+    _Atomic uint64_t events[PROFILE_PHASES][PERF_EVENTS];
+    atomic_int perf;
+#endif
+};
+
+static inline uint64_t profile_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+#if PROFILE
+/* Clock (and hardware events) at the beginning of a phase */
+struct profile_mark {
+    uint64_t clock;
+#if PERF
+    uint64_t events[PERF_EVENTS];
+#endif
+};
+
+/* Profile of the current thread, NULL if it is not accounted */
+extern _Thread_local struct profile *profile_thread;
+
+void profile_start(struct profile *p);
+void profile_stop(void);
+void profile_instances(long int n);
+#if PERF
+void perf_read(uint64_t *events);
+#endif
+
+static inline void profile_mark(struct profile_mark *m) {
+#if PERF
+    perf_read(m->events);
+#endif
+    m->clock = profile_clock();
+}
+
+/* The counters only have a single writer: no atomic read-modify-write. */
+static inline void profile_accumulate(_Atomic uint64_t *counter,
+                                      uint64_t value) {
+    atomic_store_explicit(
+        counter,
+        atomic_load_explicit(counter, memory_order_relaxed) + value,
+        memory_order_relaxed);
+}
+
+static inline void profile_add(enum profile_phase phase,
+                               const struct profile_mark *start) {
+    struct profile *p = profile_thread;
+    if (!p)
+        return;
+    profile_accumulate(&p->cycles[phase], profile_clock() - start->clock);
+    profile_accumulate(&p->count[phase], 1);
+#if PERF
+    uint64_t events[PERF_EVENTS];
+    perf_read(events);
+    for (int e = 0; e < PERF_EVENTS; ++e)
+        profile_accumulate(&p->events[phase][e],
+                           events[e] - start->events[e]);
+#endif
+}
+
+#define PROFILE_BEGIN(phase)                                                   \
+    struct profile_mark profile_start_##phase;                                 \
+    profile_mark(&profile_start_##phase)
+#define PROFILE_END(phase) profile_add(phase, &profile_start_##phase)
+#else
+#define profile_start(p) ((void)(p))
+#define profile_stop() ((void)0)
+#define profile_instances(n) ((void)(n))
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#endif
@@ -21,21 +21,153 @@
 */
 #pragma once
 
+#include <pthread.h>
 #include <stdatomic.h>
+#include <stdint.h>
 
-typedef struct {
+#include "latency.h"
+#include "profile.h"
+
+typedef struct decoding_results decoding_results_t;
+struct tilt;
+struct checkpoint;
+struct capture;
+struct corpus;
+
+/* Level of multilevel splitting: the trajectories not decoded after 'iter'
+ * iterations with a syndrome weight of at least 'weight' are copied. */
+struct split_level {
+    long int iter;
+    long int weight;
+};
+
+struct decoding_results {
     int n_threads;
     int max_iter;
     atomic_int run;
     long int *n_test;
     long int *n_success;
     long int **n_iter;
-} decoding_results_t;
+    /* Incremented before and after each update of the results of a thread */
+    atomic_uint *seq;
+    /* Results of the previous runs, when resuming from a checkpoint (NULL
+     * otherwise) */
+    const struct checkpoint *resumed;
+    /* Instances (or keys in per-key mode) are numbered, the randomness of an
+     * instance only depends on 'seed' and its number. Instances first +
+     * shard_index + n * shard_count are decoded, for n = 0, 1, ... while the
+     * number is below first + count (count is -1 if unlimited). */
+    uint64_t seed;
+    long int first;
+    long int count;
+    long int shard_index;
+    long int shard_count;
+    /* Value of n for the next instance */
+    atomic_long next;
+    /* Checkpoints (see decoder_checkpoint_start): each thread adds its
+     * results to 'cut_results' before it decodes instances from n = 'cut' on,
+     * or when it stops. 'cut_generation' numbers the checkpoints, thread i
+     * contributed to checkpoint cut_seen[i] last and cut_done[i] is set once
+     * it stopped (to 2 if it stopped in the middle of a key, its results are
+     * then unusable and so is 'cut_results' once 'cut_broken' is set).
+     * 'cut_pending' threads did not contribute yet. */
+    pthread_mutex_t cut_lock;
+    struct checkpoint *cut_results;
+    long int cut;
+    int cut_broken;
+    atomic_uint cut_generation;
+    unsigned *cut_seen;
+    int *cut_done;
+    int cut_pending;
+    /* Importance sampling: distribution of the error patterns, NULL to
+     * sample them from the nominal distribution */
+    const struct tilt *tilt;
+    /* Multilevel splitting (step-by-step decoders only): levels by
+     * increasing number of iterations (split_levels is 0 when disabled),
+     * each trajectory reaching a level is replaced by 'split_copies' copies
+     * continued with fresh randomness, of weight 1 / split_copies each */
+    const struct split_level *split;
+    int split_levels;
+    int split_copies;
+    /* Stratified sampling: width of the strata of initial syndrome weights (0
+     * when disabled), minimum probability to decode an instance and number of
+     * pilot instances */
+    int stratum_width;
+    double stratum_min;
+    long int stratum_pilot;
+    /* Stratified sampling: probability to decode an instance of each
+     * stratum, fixed by the pilot before the campaign */
+    double *stratum_rate;
+    /* Stratified sampling: number of instances that were not decoded */
+    long int *n_skipped;
+    /* Failures (not with splitting nor BATCH): number of failures where the
+     * decoder was blocked, histograms of the final syndrome weight and error
+     * weight and of the iteration where the syndrome weight was the smallest
+     * (clamped to max_iter) */
+    long int *fail_blocked;
+    long int **fail_syndrome;
+    long int **fail_error;
+    long int **fail_stall;
+    /* Latencies of the instances decoded without splitting nor BATCH: one
+     * histogram of LATENCY_BUCKETS for each latency_kind */
+    long int **latency;
+    /* Importance sampling, splitting or stratified sampling: sums of the
+     * weights of the instances by number of iterations, failures last, and
+     * sums of their squares (with splitting, of the total weight of the copies
+     * of an instance decoded in at least this number of iterations) */
+    double **w1;
+    double **w2;
+    /* Failed instances (and instances decoded in at least 'capture_slow'
+     * iterations, unless it is 0) are written there, NULL if none */
+    struct capture *capture;
+    long int capture_slow;
+    /* The iterations of a fraction 'trace_rate' of the instances are written
+     * there (see trace.h), NULL if none */
+    struct capture *trace;
+    double trace_rate;
+    /* The distributions of the counters of a fraction 'histogram_rate' of
+     * the instances are written there (see histogram.h), NULL if none */
+    struct capture *histogram;
+    double histogram_rate;
+    /* Instances are read from there instead of being generated (instance
+     * number i is record i), NULL if none */
+    const struct corpus *corpus;
+    /* Thread i runs on CPU cpus[i % n_cpus] (see affinity.h), n_cpus is 0 to
+     * let the system place the threads */
+    const int *cpus;
+    int n_cpus;
+    /* Time spent by each thread in each phase, see profile.h */
+    struct profile *profile;
+    /* Per-key mode: number of error patterns decoded with each key (0 to
+     * generate a new key for each error pattern) */
+    long int key_errors;
+    /* Per-key mode: called with the results of each key */
+    void (*key_callback)(const decoding_results_t *res, long int key,
+                         long int n_test, long int n_success,
+                         const long int *n_iter);
+};
 
 void init_decoding_results(decoding_results_t *res, int n_threads,
                            int max_iter);
 void clear_decoding_results(decoding_results_t *res);
 void sum_decoding_results(long int *test_total, long int *success_total,
                           long int *iter_total, const decoding_results_t *res);
-void decoder_loop(decoding_results_t *results, int n_threads, long int r);
+void thread_decoding_results(long int *test, const decoding_results_t *res);
+int weighted_results(const decoding_results_t *res);
+void sum_weighted_results(long int *skipped_total, double *w1_total,
+                          double *w2_total, const decoding_results_t *res);
+void sum_failure_results(long int *blocked_total, long int *syndrome_total,
+                         long int *error_total, long int *stall_total,
+                         const decoding_results_t *res);
+void sum_latency_results(long int (*latency_total)[LATENCY_BUCKETS],
+                         const decoding_results_t *res);
+void sum_profile_results(uint64_t *cycles_total, uint64_t *count_total,
+                         const decoding_results_t *res);
+#if PERF
+int sum_perf_results(uint64_t (*events_total)[PERF_EVENTS],
+                     const decoding_results_t *res);
+#endif
+void decoder_checkpoint_start(decoding_results_t *res);
+int decoder_checkpoint_collect(decoding_results_t *res, struct checkpoint *cp);
+void decoder_loop(decoding_results_t *results, int n_threads);
 void decoder_stop(decoding_results_t *res);
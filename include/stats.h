@@ -0,0 +1,86 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Version of the format of the statistics pages, to be incremented on each
+ * incompatible change. */
+#define STATS_VERSION 1
+
+/* Size of the parameters string of a page, including the null terminator */
+#define STATS_PARAMS_LENGTH 1024
+
+/* Statistics of a running simulation, published in a file mapped in memory
+ * (in /dev/shm for a shared memory segment) and refreshed by the print thread
+ * every second. Readers copy the page and retry while 'seq' is odd or changed
+ * during the copy. The fixed part is followed by
+ *   int64_t n_iter[max_iter + 1]
+ *   int64_t thread_test[n_threads]  instances decoded by each thread
+ *   double  thread_rate[n_threads]  instances per second of each thread since
+ *                                   the previous update
+ */
+struct stats_page {
+    char magic[8];
+    uint32_t version;
+    /* Size of the whole page in bytes */
+    uint32_t size;
+    /* Incremented before and after each update */
+    atomic_uint seq;
+    int32_t pid;
+    int32_t n_threads;
+    int32_t max_iter;
+    /* 1 while decoding, 0 once the simulation is over */
+    int32_t running;
+    uint32_t reserved;
+    uint64_t seed;
+    /* Seconds since the start of the simulation, and time of the update
+     * (seconds since the epoch) */
+    double elapsed;
+    double updated;
+    /* Results, including the resumed ones */
+    int64_t n_test;
+    int64_t n_success;
+    /* Compilation parameters, as printed on the first line of the output */
+    char params[STATS_PARAMS_LENGTH];
+    int64_t data[];
+};
+
+static inline int64_t *stats_n_iter(struct stats_page *p) { return p->data; }
+
+static inline int64_t *stats_thread_test(struct stats_page *p) {
+    return p->data + p->max_iter + 1;
+}
+
+static inline double *stats_thread_rate(struct stats_page *p) {
+    return (double *)(stats_thread_test(p) + p->n_threads);
+}
+
+struct stats;
+
+struct stats *stats_open(const char *filename, const char *params,
+                         int n_threads, int max_iter, uint64_t seed);
+void stats_update(struct stats *s, double elapsed, long int n_test,
+                  long int n_success, const long int *n_iter,
+                  const long int *thread_test, int running);
+void stats_close(struct stats *s);
+struct stats_page *stats_read(const char *filename);
@@ -0,0 +1,70 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#pragma once
+#include <stdint.h>
+
+#include "capture.h"
+#include "types.h"
+
+/* Version of the format of the trace files, to be incremented on each
+ * incompatible change. */
+#define TRACE_VERSION 1
+
+/* Number of records buffered for each thread (power of two), the step-by-step
+ * decoders produce one by flip attempt */
+#define TRACE_RING 65536
+
+/* State of the decoder at the end of an iteration, as stored in a trace file
+ * (with the header of the capture files, see capture.c, and the magic
+ * "QCMDPCT"). The counts of the step-by-step decoders are for a single
+ * position. */
+struct trace_record {
+    /* Number of the instance (see decoding_results_t) */
+    int64_t index;
+    /* Number of iterations so far */
+    int32_t iter;
+    uint32_t syndrome_weight;
+    /* Threshold used in this iteration */
+    uint32_t threshold;
+    /* Positions flipped in this iteration */
+    uint32_t flips;
+    /* Sizes of the black and gray lists (GRAY_* decoders) */
+    uint32_t black;
+    uint32_t gray;
+    /* Weight of the remaining error */
+    uint32_t e_weight;
+    /* Length of the flip list (BACKFLIP and BACKFLIP2) */
+    uint32_t fl_length;
+};
+
+/* Iterations of the instance decoded by a thread, set in its decoder when the
+ * instance is traced */
+struct trace_target {
+    struct capture *c;
+    int tid;
+    long int index;
+    /* Flips of the decoder at the previous record */
+    long int flips;
+};
+
+struct capture *trace_open(const char *filename, const char *params,
+                           int n_threads);
@@ -25,6 +25,7 @@
 
 #include "log2.h"
 #include "param.h"
+#include "xoshiro256plusplus.h"
 
 /* Round relevant arrays size to the next multiple of 16 * 256 bits (to use the
  * 16 ymm AVX registers). */
@@ -50,6 +51,7 @@ typedef struct array a_t;
 typedef struct flip_list fl_t;
 typedef struct decoder *decoder_t;
 typedef struct decoder_bp *decoder_bp_t;
+typedef struct decoder_batch *decoder_batch_t;
 
 /* Double linked list to store previous flips */
 struct flip_list {
@@ -60,6 +62,15 @@ struct flip_list {
     index_t length;
 };
 
+/* Number of instances decoded in lock-step by the batch decoder (one byte per
+ * instance in a 256-bit register). */
+#define BATCH_LANES 32
+
+/* One byte per lane */
+typedef bit_t lanes_t[BATCH_LANES] __attribute__((aligned(32)));
+/* One bit per lane */
+typedef uint32_t lane_mask_t;
+
 /* Array to store black and gray positions */
 struct array {
     uint8_t index[INDEX * BLOCK_LENGTH];
@@ -79,6 +90,20 @@ typedef struct {
     index_t rows[INDEX][BLOCK_WEIGHT];
 } code_t;
 
+/* Parity check matrix along with data precomputed once when it is used for
+ * many decodings (read-only once computed) */
+typedef struct {
+    code_t H;
+    /* Offsets minus BLOCK_LENGTH, for positions that wrap around */
+    index_t columns_wrap[INDEX][BLOCK_WEIGHT];
+    /* Number of offsets that do not wrap around from each position */
+    uint8_t split[INDEX][BLOCK_LENGTH];
+#ifdef JIT
+    /* Kernels generated for this key, NULL if unavailable */
+    struct jit *jit;
+#endif
+} key_data_t;
+
 typedef struct {
     bit_t vec[INDEX][2 * SIZE_AVX] __attribute__((aligned(32)));
     index_t weight;
@@ -94,15 +119,52 @@ typedef bit_t cw_t[INDEX][2 * SIZE_AVX] __attribute__((aligned(32)));
 typedef bit_t bits_t[INDEX][BLOCK_LENGTH];
 typedef bit_t counters_t[INDEX][2 * SIZE_AVX] __attribute__((aligned(32)));
 
+#if (ALGO == SBS) || (ALGO == SORT)
+/* Number of random positions drawn at once */
+#define SBS_DRAWS 256
+
+/* State of the step-by-step decoding, kept between the calls to qcmdpc_decode
+ * so that a trajectory stopped at some iteration can be continued */
+struct sbs_state {
+    /* Set by the first call to qcmdpc_decode after reset_decoder */
+    bool started;
+    /* Set when no position can be flipped anymore */
+    bool stuck;
+    unsigned threshold;
+    /* Positions drawn since a flip */
+    unsigned long missed;
+    /* The positions are drawn in bulk, from parallel generators */
+    struct prng_lanes lanes;
+    uint32_t draw_i[SBS_DRAWS];
+    uint32_t draw_k[SBS_DRAWS];
+    uint32_t draw_l[SBS_DRAWS];
+    int next_i;
+    int next_kl;
+};
+#endif
+
 /* State of the decoder */
 struct decoder {
     code_t *H;
+    /* Only set when decoding with a precomputed key */
+    key_data_t *key;
     syndrome_t *syndrome;
     e_t *e;
     bits_t bits;
     counters_t counters;
     index_t iter;
     bool blocked;
+    /* Number of positions flipped since the decoder was reset */
+    long int flips;
+    /* Smallest syndrome weight at the end of an iteration, and the first
+     * iteration where it was reached */
+    index_t min_syndrome_weight;
+    index_t min_iter;
+    /* Iterations are recorded there, NULL if they are not traced */
+    struct trace_target *trace;
+    /* Distributions of the counters are recorded there, NULL if they are not
+     * sampled */
+    struct histogram_target *histogram;
 #if (ALGO == BACKFLIP) || (ALGO == BACKFLIP2)
     fl_t fl;
 #endif
@@ -111,6 +173,9 @@ struct decoder {
     a_t gray;
     a_t black;
 #endif
+#if (ALGO == SBS) || (ALGO == SORT)
+    struct sbs_state sbs;
+#endif
 #if (ALGO == SORT)
     pos_counter_t sorted_counters[GRAY_SIZE];
 #endif
@@ -123,6 +188,10 @@ struct decoder_bp {
     e_t *e;
     e_t bits;
     index_t iter;
+    /* Smallest syndrome weight at the end of an iteration, and the first
+     * iteration where it was reached */
+    index_t min_syndrome_weight;
+    index_t min_iter;
     msg_t message;
     cw_t codeword;
     llr_t r[INDEX][BLOCK_LENGTH];
@@ -130,3 +199,27 @@ struct decoder_bp {
     llr_t c_to_v[INDEX][BLOCK_WEIGHT][BLOCK_LENGTH];
     llr_t tree[1 << LOG2(INDEX * BLOCK_LENGTH)];
 };
+
+/* Array to store black and gray positions of the batch decoder, along with the
+ * lanes in which they are black or gray */
+struct lane_array {
+    index_t position[INDEX * BLOCK_LENGTH];
+    lane_mask_t mask[INDEX * BLOCK_LENGTH];
+    index_t length;
+};
+
+/* State of the batch decoder: BATCH_LANES instances sharing the same parity
+ * check matrix are decoded in lock-step, the syndromes are interleaved. */
+struct decoder_batch {
+    code_t *H;
+    /* Second half is a copy of the first one to avoid modulo operations. */
+    lanes_t syndrome[2 * BLOCK_LENGTH];
+    lane_mask_t bits[INDEX][BLOCK_LENGTH];
+    index_t error[BATCH_LANES][ERROR_WEIGHT];
+    index_t syndrome_weight[BATCH_LANES];
+    index_t iter[BATCH_LANES];
+    /* Lanes holding an instance that is still being decoded */
+    lane_mask_t active;
+    struct lane_array gray;
+    struct lane_array black;
+};
@@ -1,15 +1,74 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
-uint64_t random_uint64_t(uint64_t *s);
 int seed_random(uint64_t *s);
-uint64_t random_lim(uint64_t limit, uint64_t *s);
 void jump(uint64_t *s);
+void seed_instance(uint64_t *s, uint64_t seed, uint64_t stream,
+                   uint64_t index);
 
 struct PRNG {
     uint64_t s[4];
-    uint64_t (*random_lim)(uint64_t limit, uint64_t *s);
-    uint64_t (*random_uint64_t)(uint64_t *s);
 };
 
 typedef struct PRNG *prng_t;
+
+/* xoshiro256++ 1.0 by David Blackman and Sebastiano Vigna (public domain),
+ * defined here so that it is inlined in the loops drawing positions. */
+static inline uint64_t xoshiro_rotl(const uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t random_uint64_t(uint64_t *s) {
+    const uint64_t result = xoshiro_rotl(s[0] + s[3], 23) + s[0];
+
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+
+    s[2] ^= t;
+
+    s[3] = xoshiro_rotl(s[3], 45);
+
+    return result;
+}
+
+/* Uniform integer in [0, limit). See
+ * <https://lemire.me/blog/2019/06/06/nearly-divisionless-random-integer-generation-on-various-systems/>.
+ */
+static inline uint64_t random_lim(uint64_t limit, uint64_t *s) {
+    uint64_t x = random_uint64_t(s);
+    __uint128_t m = (__uint128_t)x * (__uint128_t)limit;
+    uint64_t l = (uint64_t)m;
+    if (l < limit) {
+        uint64_t t = -limit % limit;
+        while (l < t) {
+            x = random_uint64_t(s);
+            m = (__uint128_t)x * (__uint128_t)limit;
+            l = (uint64_t)m;
+        }
+    }
+    return m >> 64;
+}
+
+/* Independent xoshiro256++ generators run in parallel lanes, to draw random
+ * numbers in bulk. The number of lanes does not depend on the instruction set
+ * so that the values drawn are the same with and without AVX. */
+#define PRNG_LANES 8
+
+struct prng_lanes {
+    uint64_t s[4][PRNG_LANES] __attribute__((aligned(64)));
+};
+
+/* Seed the lanes with outputs of 'prng' */
+void prng_lanes_seed(struct prng_lanes *p, prng_t prng);
+/* Next 'n' outputs ('n' is a multiple of PRNG_LANES), output 't' of lane 'i'
+ * is stored in out[t * PRNG_LANES + i]. */
+void prng_lanes_fill(struct prng_lanes *p, uint64_t *out, size_t n);
+/* 'n' uniform integers in [0, limit), drawn with the 32-bit variant of
+ * Lemire's method from the two halves of the outputs of the lanes. */
+void prng_lanes_lim(struct prng_lanes *p, uint32_t limit, uint32_t *out,
+                    size_t n);
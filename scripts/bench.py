@@ -0,0 +1,170 @@
+#!/usr/bin/python
+
+"""
+Fixed-seed throughput benchmark of the decoder.
+
+For each preset and each algorithm, the decoder is built in its own directory
+and run on the same seeded instances. The throughput, the histogram of the
+number of iterations and a checksum of this histogram are reported and, if a
+baseline file is given, compared with it: the histograms must be identical
+(the instances only depend on the seed) and the throughput must not drop by
+more than the tolerance. The decoders supporting splitting are also run with
+a single copy by level, which must not change the histogram.
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import subprocess
+import sys
+import time
+
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PRESETS = ["CPA=128", "CPA=192", "CPA=256", "CCA=128", "CCA=192", "CCA=256"]
+ALGOS = ["CLASSIC", "BACKFLIP", "BACKFLIP2", "SBS", "GRAY_B", "GRAY_BGF",
+         "GRAY_BGB", "GRAY_BG", "BP", "SORT"]
+# The step-by-step decoders flip a single bit per iteration.
+MAX_ITER = {"SBS": 22000, "SORT": 22000}
+DEFAULT_MAX_ITER = 100
+# Instances are much slower to decode with belief propagation.
+SCALE = {"BP": 0.01}
+# Splitting levels checked with a single copy (those of SORT must be after its
+# sorted phase, beyond MAX_ITER).
+SPLIT_LEVELS = {"SBS": "5000:1,10000:1"}
+
+
+def build(preset, algo, build_root, cmake_args):
+    kind, level = preset.split("=")
+    # Options are cached by cmake, use another directory for other options.
+    suffix = hashlib.sha256(" ".join(cmake_args).encode()).hexdigest()[:8]
+    directory = os.path.join(build_root, "{}{}-{}-{}".format(
+        kind.lower(), level, algo.lower(), suffix))
+    subprocess.run(["cmake", "-S", ROOT, "-B", directory,
+                    "-DPRESET_{}={}".format(kind, level),
+                    "-DALGO={}".format(algo)] + cmake_args,
+                   check=True, stdout=subprocess.DEVNULL)
+    subprocess.run(["cmake", "--build", directory, "-j",
+                    "--target", "qcmdpc_decoder"],
+                   check=True, stdout=subprocess.DEVNULL)
+    return os.path.join(directory, "qcmdpc_decoder")
+
+
+def run(executable, count, threads, seed, max_iter, options=()):
+    start = time.perf_counter()
+    output = subprocess.run([executable, "-q", "-N", str(count),
+                             "-T", str(threads), "-s", str(seed),
+                             "-i", str(max_iter)] + list(options),
+                            check=True, stdout=subprocess.PIPE,
+                            universal_newlines=True).stdout
+    elapsed = time.perf_counter() - start
+    histogram = None
+    for line in output.splitlines():
+        if line and line[0].isdigit():
+            histogram = line.split()
+    if histogram is None:
+        raise RuntimeError("no results in the output of " + executable)
+    iterations = dict(field.split(":") for field in histogram[1:])
+    return {"count": int(histogram[0]),
+            "threads": threads,
+            "seconds": elapsed,
+            "instances_per_second": int(histogram[0]) / elapsed,
+            "instances_per_second_per_thread":
+                int(histogram[0]) / elapsed / threads,
+            "iterations": {it: int(n) for it, n in iterations.items()},
+            "checksum": hashlib.sha256(
+                " ".join(histogram).encode()).hexdigest()[:16]}
+
+
+def compare(name, result, baseline, tolerance):
+    """Return False if the decoding differs from the baseline or is slower"""
+    for key in ["count", "max_iter"]:
+        if baseline[key] != result[key]:
+            print("{}: the baseline used {}={}".format(name, key, baseline[key]))
+            return False
+    if baseline["checksum"] != result["checksum"]:
+        print("{}: outcomes differ from the baseline".format(name))
+        print("  baseline: {}".format(baseline["iterations"]))
+        print("  current : {}".format(result["iterations"]))
+        return False
+    # Per thread, so that runs with different thread counts stay comparable
+    ratio = (result["instances_per_second_per_thread"] /
+             baseline["instances_per_second_per_thread"])
+    slower = ratio < 1 - tolerance
+    print("{}: {:+.1%} throughput{}".format(
+        name, ratio - 1, " (slower than the baseline)" if slower else ""))
+    return not slower
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("-p", "--presets", default="CCA=128",
+                        help="comma separated presets, or 'all' ({})".format(
+                            ",".join(PRESETS)))
+    parser.add_argument("-a", "--algos", default="GRAY_BGF",
+                        help="comma separated algorithms, or 'all'")
+    parser.add_argument("-N", "--count", type=int, default=100000,
+                        help="number of instances")
+    parser.add_argument("-T", "--threads", type=int, default=1,
+                        help="number of threads")
+    parser.add_argument("-s", "--seed", type=int, default=1,
+                        help="seed of the instances")
+    parser.add_argument("-b", "--baseline",
+                        help="compare the results with this file")
+    parser.add_argument("-o", "--output",
+                        help="save the results to this file")
+    parser.add_argument("-t", "--tolerance", type=float, default=0.05,
+                        help="relative throughput drop allowed (0.05)")
+    parser.add_argument("--build-dir", default=os.path.join(ROOT, "build",
+                                                            "bench"))
+    parser.add_argument("cmake_args", nargs="*",
+                        help="additional options for cmake (after --)")
+    args = parser.parse_args()
+
+    presets = PRESETS if args.presets == "all" else args.presets.split(",")
+    algos = ALGOS if args.algos == "all" else args.algos.split(",")
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)["results"]
+
+    results = {}
+    ok = True
+    for preset in presets:
+        for algo in algos:
+            name = "{}/{}".format(preset, algo)
+            executable = build(preset, algo, args.build_dir, args.cmake_args)
+            count = max(1, int(args.count * SCALE.get(algo, 1)))
+            max_iter = MAX_ITER.get(algo, DEFAULT_MAX_ITER)
+            result = run(executable, count, args.threads, args.seed,
+                         max_iter)
+            result["max_iter"] = max_iter
+            results[name] = result
+            print("{}: {:.1f} instances/s ({:.1f} per thread) checksum {}"
+                  .format(name, result["instances_per_second"],
+                          result["instances_per_second_per_thread"],
+                          result["checksum"]))
+            if name in baseline:
+                ok &= compare(name, result, baseline[name], args.tolerance)
+            if algo in SPLIT_LEVELS:
+                # The single copy continues the trajectory where it was at
+                # each level.
+                split = run(executable, count, args.threads, args.seed,
+                            max_iter, ["-L", SPLIT_LEVELS[algo], "-K", "1"])
+                if split["checksum"] != result["checksum"]:
+                    print("{}: outcomes differ with splitting".format(name))
+                    print("  unsplit: {}".format(result["iterations"]))
+                    print("  split  : {}".format(split["iterations"]))
+                    ok = False
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump({"seed": args.seed, "results": results}, f, indent=2)
+            f.write("\n")
+
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,126 @@
+#!/usr/bin/python
+
+"""
+Compare the distributions of the counters recorded with -H with the threshold
+model.
+
+The records are grouped by remaining error weight and by syndrome weight (in
+bins of the given width). For each group, the mean counters of the positions
+in and out of the error are printed next to those of the binomial model of
+threshold.c, along with the threshold of the model (compute_threshold) and the
+empirical one: the smallest counter value at which positions in the error
+outnumber the others.
+"""
+
+import argparse
+import math
+import re
+import struct
+import sys
+
+
+HEADER = struct.Struct("=8sIIII")
+MAGIC = b"QCMDPCH\0"
+VERSION = 1
+
+
+def read(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    magic, version, params_length, record_size, _ = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("{} is not a counter file".format(filename))
+    params = data[HEADER.size:HEADER.size + params_length].decode()
+    param = {k: int(v) for k, v in re.findall(r"-D(\w+)=(-?\d+)\b", params)}
+    d = param["BLOCK_WEIGHT"]
+    record = struct.Struct("=qiIII{}I".format(2 * (d + 1)))
+    if record.size != record_size:
+        raise ValueError("unexpected record size in {}".format(filename))
+    offset = HEADER.size + (params_length + 7) // 8 * 8
+    records = [record.unpack_from(data, o)
+               for o in range(offset, len(data) - record_size + 1,
+                              record_size)]
+    return param, records
+
+
+def lnbino(n, t):
+    if t == 0 or n == t:
+        return 0.
+    return math.lgamma(n + 1) - math.lgamma(t + 1) - math.lgamma(n - t + 1)
+
+
+def x_val(r, d, n, t):
+    """X = sum((l - 1) * E_l, l odd) / sum(E_l, l odd), as in threshold.c"""
+    x = 0.
+    denom = 0.
+    for i in range(1, min(10, t), 2):
+        e = math.exp(lnbino(r * d, i) + lnbino(r * (n - d), t - i) -
+                     lnbino(r * n, t))
+        x += (i - 1) * e
+        denom += e
+    return 0. if denom == 0. else x / denom
+
+
+def model(r, d, n, S, t):
+    """Probabilities for a counter to be incremented, out and in the error,
+    and threshold of compute_threshold"""
+    x = x_val(r, d, n, t) * S
+    p = ((r * d - 1) * S - x) / (r * n - t) / d
+    q = (S + x) / t / d
+    if q >= 1 or p <= 0:
+        return p, q, d
+    threshold = math.ceil(
+        (d * (math.log1p(-q) - math.log1p(-p)) + math.log(t) -
+         math.log(r * n - t)) /
+        (math.log(p) - math.log(q) + math.log1p(-q) - math.log1p(-p)))
+    return p, q, min(max(threshold, (d + 1) // 2), d)
+
+
+def mean(hist):
+    total = sum(hist)
+    return sum(v * c for v, c in enumerate(hist)) / total if total else 0.
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("filename")
+    parser.add_argument("-w", "--width", type=int, default=50,
+                        help="width of the bins of syndrome weight (50)")
+    parser.add_argument("-m", "--min-records", type=int, default=10,
+                        help="only print groups of at least this number of "
+                        "records (10)")
+    args = parser.parse_args()
+
+    param, records = read(args.filename)
+    r = param["INDEX"]
+    n = param["BLOCK_LENGTH"]
+    d = param["BLOCK_WEIGHT"]
+
+    groups = {}
+    for _, _, S, t, _, *hist in records:
+        if t == 0:
+            continue
+        key = (t, S // args.width)
+        group = groups.setdefault(key, [0, 0, [0] * (d + 1), [0] * (d + 1)])
+        group[0] += 1
+        group[1] += S
+        group[2] = [a + b for a, b in zip(group[2], hist[:d + 1])]
+        group[3] = [a + b for a, b in zip(group[3], hist[d + 1:])]
+
+    print("{:>5} {:>11} {:>7} {:>7} {:>7} {:>7} {:>7} {:>5} {:>5}".format(
+        "t", "S", "records", "in", "model", "out", "model", "thr", "model"))
+    for (t, b), (count, S, hist_in, hist_out) in sorted(groups.items()):
+        if count < args.min_records:
+            continue
+        p, q, threshold = model(r, d, n, S / count, t)
+        empirical = next((v for v in range((d + 1) // 2, d + 1)
+                          if hist_in[v] and hist_in[v] >= hist_out[v]), d)
+        print("{:5} {:>11} {:7} {:7.2f} {:7.2f} {:7.2f} {:7.2f} {:5} {:5}"
+              .format(t, "{}-{}".format(b * args.width,
+                                        (b + 1) * args.width - 1),
+                      count, mean(hist_in), d * q, mean(hist_out), d * p,
+                      empirical, threshold))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
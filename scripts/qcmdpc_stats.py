@@ -1,5 +1,6 @@
 #!/usr/bin/python
-from math import log2, log1p, expm1, inf
+from math import log2, log1p, expm1, inf, sqrt
+from statistics import NormalDist
 from gmpy2 import bincoef
 
 from statsmodels.stats.proportion import proportion_confint
@@ -80,6 +81,31 @@ def get_dfr(distr, alpha=ALPHA):
     return dfr
 
 
+def get_weighted_dfr(weighted, alpha=ALPHA, split=False):
+    """DFR by iteration from the sums of weights of an importance sampling
+    (or splitting) simulation, with a normal confidence interval. With
+    splitting, the sums of squares are already cumulated over the
+    iterations."""
+    n, sums = weighted
+    z = NormalDist().inv_cdf(1 - alpha / 2)
+    dfr = {}
+
+    s1 = s2 = 0.
+    for it, (w1, w2) in sorted((sums.items()), reverse=True):
+        if it == -1:
+            s1, s2 = w1, w2
+            continue
+        if s1 > 0 and n > 1:
+            p = s1 / n
+            sigma = sqrt(max(s2 / n - p * p, 0) / (n - 1))
+            lower = log2(p - z * sigma) if p > z * sigma else -inf
+            dfr[it] = lower, log2(p), log2(p + z * sigma)
+        s1 += w1
+        s2 = w2 if split else s2 + w2
+
+    return dfr
+
+
 def parse_param(s):
     def int_float_str(x):
         if isinstance(x, (int, float)):
@@ -99,11 +125,49 @@ def parse_param(s):
     return dict(l)
 
 
+def parse_failures(s):
+    """
+    Parse "failures=N blocked=B syndrome=w:n,... error=w:n,... stall=it:n,..."
+    into a dictionary of counts and histograms.
+    """
+    failures = {}
+    for field in s.split():
+        name, value = field.split('=')
+        if name in ['failures', 'blocked']:
+            failures[name] = int(value)
+        else:
+            failures[name] = dict(
+                map(int, e.split(':')) for e in value.split(',') if e)
+    return failures
+
+
+def parse_latency(s):
+    """
+    Parse "latency=KIND n=N p50=C p99=C p99.9=C buckets=c:n,..." into the kind
+    and a dictionary of counts and of the histogram.
+    """
+    latency = {}
+    for field in s.split():
+        name, value = field.split('=')
+        if name == 'latency':
+            kind = value
+        elif name == 'buckets':
+            latency[name] = dict(
+                map(int, e.split(':')) for e in value.split(',') if e)
+        else:
+            latency[name] = int(value)
+    return kind, latency
+
+
 def get_data(filename):
     stats = {}
 
     s_param = ""
     s_results = ""
+    s_weighted = ""
+    s_failures = ""
+    latency = {}
+    split = False
     with open(filename, 'r') as file:
         for line in file:
             line = line.rstrip()
@@ -112,7 +176,25 @@ def get_data(filename):
             if line[0] == '-':
                 s_param = " ".join(sorted(line.split()))
                 continue
-            s_results = line[:]
+            if line.startswith('# split='):
+                split = True
+                continue
+            # Final state of the failed instances
+            if line.startswith('# failures='):
+                s_failures = line[2:]
+                continue
+            # Latencies of the setup and of the decoding of the instances
+            if line.startswith('# latency='):
+                kind, value = parse_latency(line[2:])
+                latency[kind] = value
+                continue
+            # Sums of weights with importance sampling or splitting
+            if line.startswith('w '):
+                s_weighted = line[2:]
+                continue
+            # Other lines (per-key results, ...) are not aggregated results.
+            if line[0].isdigit():
+                s_results = line[:]
 
     entry = parse_param(s_param)
 
@@ -127,6 +209,18 @@ def get_data(filename):
         return None
 
     entry['iteration'] = results
+    if s_weighted:
+        s_weighted = s_weighted.split()
+        weighted = [e.split(":") for e in s_weighted[1:]]
+        if weighted and weighted[-1][0][0] == '>':
+            weighted[-1][0] = '-1'
+        entry['weighted'] = (int(s_weighted[0]), dict(
+            map(lambda e: (int(e[0]), (float(e[1]), float(e[2]))), weighted)))
+        entry['split'] = split
+    if s_failures:
+        entry['failures'] = parse_failures(s_failures)
+    if latency:
+        entry['latency'] = latency
     entry['density'], entry['distance'] = get_density(
         *[entry[p] for p in ['index', 'block_length', 'block_weight', 'error_weight', 'weak', 'error_floor', 'weak_p', 'error_floor_p']])
 
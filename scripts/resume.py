@@ -0,0 +1,127 @@
+#!/usr/bin/python
+
+"""
+Check that a campaign killed after checkpoints and resumed gives the results
+of an uninterrupted one.
+
+The decoder is run with several threads and a checkpoint file, a checkpoint
+is requested with SIGHUP while the threads are busy and the decoder is killed
+once it is written. After a few such rounds, the campaign is resumed until
+the end: it must have decoded exactly the requested number of instances, with
+the same histogram as a run without interruption (the instances only depend
+on the seed).
+"""
+
+import argparse
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def histogram(output):
+    result = None
+    for line in output.splitlines():
+        if line and line[0].isdigit():
+            result = line.split()
+    if result is None:
+        raise RuntimeError("no results in the output of the decoder")
+    return result
+
+
+def command(args, options=()):
+    key_errors = ["-M", str(args.key_errors)] if args.key_errors else []
+    return [args.executable, "-q", "-N", str(args.count), "-T",
+            str(args.threads), "-s", str(args.seed)] + key_errors + \
+        args.decoder_args + list(options)
+
+
+def interrupt(args, checkpoint, delay):
+    """Run until a checkpoint requested after 'delay' seconds is written,
+    then kill the decoder. Return False if it ended before."""
+    options = ["-c", checkpoint]
+    if os.path.exists(checkpoint):
+        options.append("-r")
+    process = subprocess.Popen(command(args, options),
+                               stdout=subprocess.DEVNULL)
+    time.sleep(delay)
+    before = os.stat(checkpoint).st_mtime_ns \
+        if os.path.exists(checkpoint) else None
+    process.send_signal(signal.SIGHUP)
+    # The checkpoint is written once the threads decoded the instances handed
+    # out before it.
+    deadline = time.monotonic() + 60
+    while process.poll() is None and time.monotonic() < deadline:
+        if os.path.exists(checkpoint) and \
+                os.stat(checkpoint).st_mtime_ns != before:
+            break
+        time.sleep(0.05)
+    if process.poll() is not None:
+        return False
+    process.kill()
+    process.wait()
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("-x", "--executable",
+                        default=os.path.join(ROOT, "build", "qcmdpc_decoder"),
+                        help="decoder to check (build/qcmdpc_decoder)")
+    parser.add_argument("-N", "--count", type=int, default=100000,
+                        help="number of instances")
+    parser.add_argument("-T", "--threads", type=int, default=4,
+                        help="number of threads")
+    parser.add_argument("-s", "--seed", type=int, default=1,
+                        help="seed of the instances")
+    parser.add_argument("-M", "--key-errors", type=int, default=0,
+                        help="per-key mode, with this number of errors by "
+                        "key (-N is then the number of keys)")
+    parser.add_argument("-k", "--rounds", type=int, default=3,
+                        help="number of interrupted runs")
+    parser.add_argument("-d", "--delay", type=float, default=2,
+                        help="seconds before each checkpoint request")
+    parser.add_argument("decoder_args", nargs="*",
+                        help="additional options for the decoder (after --)")
+    args = parser.parse_args()
+
+    reference = histogram(subprocess.run(
+        command(args), check=True, stdout=subprocess.PIPE,
+        universal_newlines=True).stdout)
+
+    ok = True
+    with tempfile.TemporaryDirectory() as directory:
+        checkpoint = os.path.join(directory, "checkpoint")
+        for k in range(args.rounds):
+            if not interrupt(args, checkpoint, args.delay):
+                print("round {}: the campaign ended before the checkpoint, "
+                      "use more instances".format(k))
+                ok = False
+                break
+        resumed = histogram(subprocess.run(
+            command(args, ["-c", checkpoint, "-r"]), check=True,
+            stdout=subprocess.PIPE, universal_newlines=True).stdout)
+
+    expected = args.count * max(args.key_errors, 1)
+    if int(resumed[0]) != expected:
+        print("{} instances decoded instead of {}".format(resumed[0],
+                                                          expected))
+        ok = False
+    if resumed != reference:
+        print("outcomes differ from the uninterrupted run")
+        print("  uninterrupted: {}".format(" ".join(reference)))
+        print("  resumed      : {}".format(" ".join(resumed)))
+        ok = False
+    if ok:
+        print("{} instances: {}".format(expected, " ".join(resumed)))
+
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -46,10 +46,38 @@ if data['density'] != 0:
 if data['distance']:
     print("{:13}: {}".format('distance', data['distance']))
 
+if data.get('batch'):
+    # The instances of a batch share their key, they are not independent.
+    print("{:13}: {} (the intervals are too narrow)".format(
+        'batch', data['batch']))
+
 print("{:13}:".format('dfr (with CI)'))
 for it, dfr in sorted((data['dfr'].items())):
     print("{:16}: {:.3f} {:.3f} {:.3f}".format(it, *dfr))
 
+if 'weighted' in data:
+    print("{:13}:".format('weighted dfr (with CI)'))
+    weighted = qcmdpc_stats.get_weighted_dfr(
+        data['weighted'], alpha, data['split'])
+    for it, dfr in sorted((weighted.items())):
+        print("{:16}: {:.3f} {:.3f} {:.3f}".format(it, *dfr))
+
+if 'failures' in data and data['failures']['failures']:
+    f = data['failures']
+    print("{:13}: {} ({} blocked)".format(
+        'failures', f['failures'], f['blocked']))
+    for name in ['error', 'syndrome', 'stall']:
+        common = sorted(f[name].items(), key=lambda e: -e[1])[:5]
+        print("{:13}: {}".format(
+            'most ' + name, " ".join("{}:{}".format(*e) for e in common)))
+
+if 'latency' in data:
+    for kind in ['setup', 'success', 'failure']:
+        if kind in data['latency']:
+            l = data['latency'][kind]
+            print("{:13}: p50 {} p99 {} p99.9 {} cycles ({} instances)".format(
+                'latency ' + kind, l['p50'], l['p99'], l['p99.9'], l['n']))
+
 if data['density'] != 0:
     print("{:13}:".format('dfr+density (with CI)'))
     for it, dfr in sorted((data['dfr'].items())):
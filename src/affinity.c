@@ -0,0 +1,138 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "affinity.h"
+
+const char *const affinity_names[AFFINITY_POLICIES] = {"none", "compact",
+                                                       "scatter"};
+
+/* Position of a CPU in the topology */
+struct cpu {
+    int cpu;
+    int package;
+    int core;
+    /* Rank among the hardware threads of its core */
+    int rank;
+};
+
+/* Returns the policy named 'name', -1 if there is none. */
+int affinity_parse(const char *name) {
+    for (int p = 0; p < AFFINITY_POLICIES; ++p)
+        if (!strcmp(name, affinity_names[p]))
+            return p;
+    return -1;
+}
+
+#ifdef __linux__
+/* Reads an integer from the topology of 'cpu' in sysfs, 'fallback' if it is
+ * not available. */
+static int topology(int cpu, const char *name, int fallback) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s",
+             cpu, name);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return fallback;
+    int value;
+    if (fscanf(f, "%d", &value) != 1)
+        value = fallback;
+    fclose(f);
+    return value;
+}
+
+static int cmp_compact(const void *a, const void *b) {
+    const struct cpu *x = a;
+    const struct cpu *y = b;
+    if (x->package != y->package)
+        return x->package - y->package;
+    if (x->core != y->core)
+        return x->core - y->core;
+    return x->rank - y->rank;
+}
+
+static int cmp_scatter(const void *a, const void *b) {
+    const struct cpu *x = a;
+    const struct cpu *y = b;
+    if (x->rank != y->rank)
+        return x->rank - y->rank;
+    if (x->core != y->core)
+        return x->core - y->core;
+    return x->package - y->package;
+}
+#endif
+
+/* Write to 'cpus' (of 'size' elements) the CPUs the process may run on, in
+ * the order the threads are placed on them with 'policy'. Returns their
+ * number, 0 if the threads are not placed (AFFINITY_NONE, or not
+ * supported). */
+int affinity_cpus(enum affinity_policy policy, int *cpus, int size) {
+#ifdef __linux__
+    cpu_set_t set;
+    if (policy == AFFINITY_NONE || sched_getaffinity(0, sizeof(set), &set))
+        return 0;
+
+    struct cpu *c = malloc(CPU_SETSIZE * sizeof(struct cpu));
+    int n = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < size; ++cpu) {
+        if (!CPU_ISSET(cpu, &set))
+            continue;
+        c[n].cpu = cpu;
+        c[n].package = topology(cpu, "physical_package_id", 0);
+        c[n].core = topology(cpu, "core_id", cpu);
+        c[n].rank = 0;
+        for (int i = 0; i < n; ++i)
+            if (c[i].package == c[n].package && c[i].core == c[n].core)
+                ++c[n].rank;
+        ++n;
+    }
+    qsort(c, n, sizeof(struct cpu),
+          (policy == AFFINITY_COMPACT) ? cmp_compact : cmp_scatter);
+    for (int i = 0; i < n; ++i)
+        cpus[i] = c[i].cpu;
+    free(c);
+    return n;
+#else
+    (void)policy;
+    (void)cpus;
+    (void)size;
+    return 0;
+#endif
+}
+
+/* Run the thread created with 'attr' on 'cpu'. Returns 0 on success. */
+int affinity_set(pthread_attr_t *attr, int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+#else
+    (void)attr;
+    (void)cpu;
+    return 1;
+#endif
+}
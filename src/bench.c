@@ -0,0 +1,495 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "code.h"
+#include "codegen.h"
+#include "errorgen.h"
+#include "param.h"
+#include "profile.h"
+#include "sparse_cyclic.h"
+#include "threshold.h"
+#include "types.h"
+#include "xoshiro256plusplus.h"
+#if (ALGO != BP)
+#include "decoder.h"
+#endif
+#ifdef JIT
+#include "jit.h"
+#endif
+
+/* Microbenchmarks of the kernels of the decoder, for the parameters it was
+ * compiled with. Each vector kernel is also checked bit for bit against its
+ * scalar reference. The results are written as JSON. */
+
+/* Result of a check against a scalar reference */
+enum { CHECK_NONE, CHECK_OK, CHECK_FAIL };
+
+FILE *out;
+int first_kernel = 1;
+int failures = 0;
+
+/* Add the entry of a kernel taking 'total' cycles for 'calls' calls of
+ * 'elements' elements each. */
+static void report(const char *name, uint64_t total, long int calls,
+                   long int elements, int check) {
+    const char *checks[] = {"none", "ok", "fail"};
+    fprintf(out,
+            "%s\n    {\"name\": \"%s\", \"calls\": %ld, \"elements\": %ld, "
+            "\"cycles_per_call\": %.2f, \"cycles_per_element\": %.4f, "
+            "\"check\": \"%s\"}",
+            first_kernel ? "" : ",", name, calls, elements,
+            (double)total / calls, (double)total / calls / elements,
+            checks[check]);
+    first_kernel = 0;
+    failures += (check == CHECK_FAIL);
+}
+
+/* Time 'calls' evaluations of the statement 'STMT' */
+#define TIME(TOTAL, CALLS, STMT)                                               \
+    do {                                                                       \
+        uint64_t _start = profile_clock();                                     \
+        for (long int _i = 0; _i < (CALLS); ++_i) {                            \
+            STMT;                                                              \
+        }                                                                      \
+        (TOTAL) = profile_clock() - _start;                                    \
+    } while (0)
+
+/* Prevent the compiler from optimizing away the result of a kernel */
+static inline void escape(const void *p) {
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+static void random_instance(code_t *H, e_t *e, prng_t prng) {
+    index_t error_sparse[ERROR_WEIGHT];
+    generate_random_code(H, prng);
+    generate_random_error(error_sparse, ERROR_WEIGHT, prng);
+    error_sparse_to_dense(e, error_sparse, ERROR_WEIGHT);
+}
+
+static void bench_syndrome(const code_t *H_in, e_t *e, long int calls) {
+    code_t H = *H_in;
+    static syndrome_t syndrome __attribute__((aligned(32)));
+    static bit_t reference[2 * SIZE_AVX] __attribute__((aligned(32)));
+    uint64_t total;
+
+    TIME(total, calls, {
+        memset(reference, 0, sizeof(reference));
+        multiply_xor_mod2(reference, H.columns[0], e->vec[0], BLOCK_WEIGHT,
+                          BLOCK_LENGTH);
+        escape(reference);
+    });
+    report("multiply_xor_mod2", total, calls, BLOCK_LENGTH, CHECK_NONE);
+    for (index_t i = 1; i < INDEX; ++i)
+        multiply_xor_mod2(reference, H.columns[i], e->vec[i], BLOCK_WEIGHT,
+                          BLOCK_LENGTH);
+
+#ifdef AVX
+    static bit_t z[2 * SIZE_AVX] __attribute__((aligned(32)));
+    TIME(total, calls, {
+        memset(z, 0, sizeof(z));
+        multiply_xor_mod2_avx2(z, H.rows[0], e->vec[0], BLOCK_WEIGHT,
+                               SIZE_AVX);
+        escape(z);
+    });
+    for (index_t i = 1; i < INDEX; ++i)
+        multiply_xor_mod2_avx2(z, H.rows[i], e->vec[i], BLOCK_WEIGHT,
+                               SIZE_AVX);
+    report("multiply_xor_mod2_avx2", total, calls, BLOCK_LENGTH,
+           memcmp(z, reference, BLOCK_LENGTH) ? CHECK_FAIL : CHECK_OK);
+#endif
+
+    TIME(total, calls, {
+        compute_syndrome(&syndrome, &H, e);
+        escape(&syndrome);
+    });
+    index_t weight = 0;
+    for (index_t j = 0; j < BLOCK_LENGTH; ++j)
+        weight += reference[j];
+    report("compute_syndrome", total, calls, INDEX * BLOCK_LENGTH,
+           (memcmp(syndrome.vec, reference, BLOCK_LENGTH) ||
+            syndrome.weight != weight)
+               ? CHECK_FAIL
+               : CHECK_OK);
+}
+
+static void bench_counters(const code_t *H_in, e_t *e, long int calls) {
+    code_t H = *H_in;
+    static syndrome_t syndrome __attribute__((aligned(32)));
+    static counters_t reference __attribute__((aligned(32)));
+    static counters_t counters __attribute__((aligned(32)));
+    uint64_t total;
+
+    compute_syndrome(&syndrome, &H, e);
+    memcpy(syndrome.vec + BLOCK_LENGTH, syndrome.vec, BLOCK_LENGTH);
+
+    TIME(total, calls, {
+        memset(reference[0], 0, BLOCK_LENGTH);
+        multiply_add(reference[0], H.rows[0], syndrome.vec, BLOCK_WEIGHT,
+                     BLOCK_LENGTH);
+        escape(reference);
+    });
+    report("multiply_add", total, calls, BLOCK_LENGTH, CHECK_NONE);
+    for (index_t i = 1; i < INDEX; ++i) {
+        memset(reference[i], 0, BLOCK_LENGTH);
+        multiply_add(reference[i], H.rows[i], syndrome.vec, BLOCK_WEIGHT,
+                     BLOCK_LENGTH);
+    }
+
+    int check = CHECK_OK;
+#ifdef AVX
+    TIME(total, calls, {
+        multiply_avx2(counters[0], H.columns[0], syndrome.vec, BLOCK_WEIGHT,
+                      SIZE_AVX);
+        escape(counters);
+    });
+    for (index_t i = 1; i < INDEX; ++i)
+        multiply_avx2(counters[i], H.columns[i], syndrome.vec, BLOCK_WEIGHT,
+                      SIZE_AVX);
+    for (index_t i = 0; i < INDEX; ++i)
+        if (memcmp(counters[i], reference[i], BLOCK_LENGTH))
+            check = CHECK_FAIL;
+    report("multiply_avx2", total, calls, BLOCK_LENGTH, check);
+#endif
+
+    memset(counters, 0, sizeof(counters));
+    TIME(total, calls, {
+        compute_counters(counters, syndrome.vec, &H);
+        escape(counters);
+    });
+    check = CHECK_OK;
+    for (index_t i = 0; i < INDEX; ++i)
+        if (memcmp(counters[i], reference[i], BLOCK_LENGTH))
+            check = CHECK_FAIL;
+    report("compute_counters", total, calls, INDEX * BLOCK_LENGTH, check);
+
+#if defined(JIT) && defined(AVX)
+    /* Skipped if no executable memory can be mapped */
+    struct jit *jit = jit_alloc();
+    if (jit && !jit_compile(jit, &H)) {
+        memset(counters, 0, sizeof(counters));
+        TIME(total, calls, {
+            jit_compute_counters(jit, counters, syndrome.vec);
+            escape(counters);
+        });
+        check = CHECK_OK;
+        for (index_t i = 0; i < INDEX; ++i)
+            if (memcmp(counters[i], reference[i], BLOCK_LENGTH))
+                check = CHECK_FAIL;
+        report("jit_compute_counters", total, calls, INDEX * BLOCK_LENGTH,
+               check);
+    }
+    jit_free(jit);
+#endif
+}
+
+#if (ALGO != BP)
+/* Single counters and column flips, through the decoder without the key data,
+ * with it and with the generated kernels when available. The flips are checked
+ * against the ones without the key data. */
+static void bench_single(const code_t *H_in, e_t *e, long int calls,
+                         prng_t prng) {
+    static key_data_t key __attribute__((aligned(32)));
+    static syndrome_t syndrome __attribute__((aligned(32)));
+    static syndrome_t saved __attribute__((aligned(32)));
+    static syndrome_t flipped __attribute__((aligned(32)));
+    static counters_t reference __attribute__((aligned(32)));
+    decoder_t dec = aligned_alloc(64, sizeof(*dec));
+    uint64_t total;
+
+    key.H = *H_in;
+    compute_key_data(&key);
+    int variants = 2;
+#ifdef JIT
+    struct jit *jit = jit_alloc();
+    if (jit && jit_compile(jit, &key.H)) {
+        jit_free(jit);
+        jit = NULL;
+    }
+    if (jit)
+        variants = 3;
+#endif
+    compute_syndrome(&syndrome, &key.H, e);
+    memcpy(syndrome.vec + BLOCK_LENGTH, syndrome.vec, BLOCK_LENGTH);
+    compute_counters(reference, syndrome.vec, &key.H);
+
+    /* Random positions, the same for all the variants */
+    index_t *positions = malloc(calls * sizeof(index_t));
+    for (long int i = 0; i < calls; ++i)
+        positions[i] = random_lim(INDEX * BLOCK_LENGTH, prng->s);
+    /* Positions flipped once for the comparison of the syndromes */
+    long int flips = calls < BLOCK_LENGTH ? calls : BLOCK_LENGTH;
+
+    const char *names[3][2] = {{"get_counter", "flip_column"},
+                               {"get_counter_key", "flip_column_key"},
+                               {"get_counter_jit", "flip_column_jit"}};
+
+    for (int variant = 0; variant < variants; ++variant) {
+#ifdef JIT
+        key.jit = (variant == 2) ? jit : NULL;
+#endif
+        if (variant)
+            init_decoder_key(dec, &key, e, &syndrome);
+        else
+            init_decoder(dec, &key.H, e, &syndrome);
+
+        bit_t sum = 0;
+        TIME(total, calls, {
+            index_t p = positions[_i];
+            sum += get_counter(dec, p / BLOCK_LENGTH, p % BLOCK_LENGTH);
+        });
+        escape(&sum);
+        int check = CHECK_OK;
+        for (long int i = 0; i < calls; ++i) {
+            index_t k = positions[i] / BLOCK_LENGTH;
+            index_t j = positions[i] % BLOCK_LENGTH;
+            if (get_counter(dec, k, j) != reference[k][j])
+                check = CHECK_FAIL;
+        }
+        report(names[variant][0], total, calls, BLOCK_WEIGHT, check);
+
+        /* Flipping every column twice restores the syndrome. */
+        memcpy(&saved, &syndrome, sizeof(syndrome));
+        TIME(total, calls, {
+            index_t p = positions[_i];
+            flip_column(dec, p / BLOCK_LENGTH, p % BLOCK_LENGTH);
+        });
+        for (long int i = 0; i < calls; ++i)
+            flip_column(dec, positions[i] / BLOCK_LENGTH,
+                        positions[i] % BLOCK_LENGTH);
+        check = CHECK_OK;
+        if (memcmp(saved.vec, syndrome.vec, BLOCK_LENGTH))
+            check = CHECK_FAIL;
+        /* A single flip changes the counters of the column by the weight of
+         * the intersections, check it against the scalar product. */
+        index_t k = positions[0] / BLOCK_LENGTH;
+        index_t j = positions[0] % BLOCK_LENGTH;
+        flip_column(dec, k, j);
+        if (get_counter(dec, k, j) != BLOCK_WEIGHT - reference[k][j])
+            check = CHECK_FAIL;
+        for (long int i = 1; i < flips; ++i)
+            flip_column(dec, positions[i] / BLOCK_LENGTH,
+                        positions[i] % BLOCK_LENGTH);
+        if (!variant)
+            memcpy(&flipped, &syndrome, sizeof(syndrome));
+        else if (memcmp(flipped.vec, syndrome.vec, BLOCK_LENGTH))
+            check = CHECK_FAIL;
+        memcpy(&syndrome, &saved, sizeof(syndrome));
+        report(names[variant][1], total, calls, BLOCK_WEIGHT, check);
+    }
+
+    free(positions);
+#ifdef JIT
+    key.jit = NULL;
+    jit_free(jit);
+#endif
+    free(dec);
+}
+#endif
+
+static void bench_threshold(long int calls, prng_t prng) {
+    uint64_t total;
+    unsigned sum = 0;
+    /* Syndrome weights around the initial one */
+    unsigned *weights = malloc(calls * sizeof(unsigned));
+    for (long int i = 0; i < calls; ++i)
+        weights[i] = 1 + random_lim(BLOCK_LENGTH / 2, prng->s);
+
+    /* The exact threshold is much slower, time fewer calls */
+    TIME(total, calls / 100 + 1,
+         sum += compute_threshold(weights[_i], ERROR_WEIGHT));
+    report("compute_threshold", total, calls / 100 + 1, 1, CHECK_NONE);
+#if (ALGO == GRAY_BGF) || (ALGO == GRAY_BGB) || (ALGO == GRAY_B) ||            \
+    (ALGO == GRAY_BG)
+    TIME(total, calls, sum += compute_threshold_affine(weights[_i]));
+    report("compute_threshold_affine", total, calls, 1, CHECK_NONE);
+#endif
+    escape(&sum);
+    free(weights);
+}
+
+static void bench_random(code_t *H, long int calls, prng_t prng) {
+    uint64_t total;
+    index_t error_sparse[ERROR_WEIGHT];
+    uint64_t sum = 0;
+
+    TIME(total, calls, {
+        sparse_rand(error_sparse, ERROR_WEIGHT, INDEX * BLOCK_LENGTH, prng);
+        escape(error_sparse);
+    });
+    report("sparse_rand", total, calls, ERROR_WEIGHT, CHECK_NONE);
+
+    /* Error floor patterns, ERROR_FLOOR_P positions around a column */
+    TIME(total, calls, {
+        generate_near_codeword(error_sparse, H, prng);
+        escape(error_sparse);
+    });
+    report("generate_near_codeword", total, calls, ERROR_WEIGHT, CHECK_NONE);
+
+    TIME(total, calls * ERROR_WEIGHT,
+         sum += random_lim(INDEX * BLOCK_LENGTH, prng->s));
+    escape(&sum);
+    report("random_lim", total, calls * ERROR_WEIGHT, 1, CHECK_NONE);
+
+    /* The lanes are checked against independent scalar generators with the
+     * same states. */
+    enum { DRAWS = 64 * PRNG_LANES };
+    static uint64_t raw[DRAWS] __attribute__((aligned(64)));
+    static uint32_t draws[DRAWS] __attribute__((aligned(64)));
+    struct prng_lanes lanes;
+    uint64_t scalar[PRNG_LANES][4];
+    prng_lanes_seed(&lanes, prng);
+    for (int i = 0; i < PRNG_LANES; ++i)
+        for (int w = 0; w < 4; ++w)
+            scalar[i][w] = lanes.s[w][i];
+    prng_lanes_fill(&lanes, raw, DRAWS);
+    int check = CHECK_OK;
+    for (int j = 0; j < DRAWS; ++j)
+        if (raw[j] != random_uint64_t(scalar[j % PRNG_LANES]))
+            check = CHECK_FAIL;
+    TIME(total, calls, {
+        prng_lanes_fill(&lanes, raw, DRAWS);
+        escape(raw);
+    });
+    report("prng_lanes_fill", total, calls, DRAWS, check);
+
+    /* Same draws as the scalar method on the halves of the outputs */
+    struct prng_lanes copy = lanes;
+    prng_lanes_lim(&lanes, BLOCK_LENGTH, draws, DRAWS);
+    check = CHECK_OK;
+    const uint32_t t = -(uint32_t)BLOCK_LENGTH % BLOCK_LENGTH;
+    for (int j = 0, k = 0; k < DRAWS; ++j) {
+        if (j % (8 * PRNG_LANES) == 0)
+            prng_lanes_fill(&copy, raw, 8 * PRNG_LANES);
+        uint64_t x = raw[j % (8 * PRNG_LANES)];
+        for (int h = 0; h < 2 && k < DRAWS; ++h, x >>= 32) {
+            uint64_t m = (x & 0xffffffff) * BLOCK_LENGTH;
+            if ((uint32_t)m >= t && draws[k++] != (m >> 32))
+                check = CHECK_FAIL;
+        }
+    }
+    TIME(total, calls, {
+        prng_lanes_lim(&lanes, BLOCK_LENGTH, draws, DRAWS);
+        escape(draws);
+    });
+    report("prng_lanes_lim", total, calls, DRAWS, check);
+}
+
+static void print_usage(char *arg0) {
+    fprintf(stderr,
+            "usage: %s [OPTIONS]\n"
+            "\n"
+            "-n, --calls N          number of calls of each kernel (1000)\n"
+            "-s, --seed SEED        seed of the instances (0)\n"
+            "-o, --output FILE      write the results to FILE instead of the "
+            "standard\n"
+            "                       output\n",
+            arg0);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    long int calls = 1000;
+    uint64_t seed = 0;
+    const char *output = NULL;
+
+    const char *options = "n:s:o:";
+    static struct option longopts[] = {{"calls", required_argument, 0, 'n'},
+                                       {"seed", required_argument, 0, 's'},
+                                       {"output", required_argument, 0, 'o'},
+                                       {NULL, 0, 0, 0}};
+    int ch;
+    while ((ch = getopt_long(argc, argv, options, longopts, NULL)) != -1) {
+        switch (ch) {
+        case 'n':
+            calls = atol(optarg);
+            if (calls < 1)
+                print_usage(argv[0]);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+
+    out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Could not create '%s'\n", output);
+        exit(EXIT_FAILURE);
+    }
+
+    struct PRNG prng;
+    seed_instance(prng.s, seed, 0, 0);
+
+    code_t H;
+    static e_t e __attribute__((aligned(32)));
+    random_instance(&H, &e, &prng);
+
+    fprintf(out,
+            "{\n  \"index\": %d, \"block_length\": %d, \"block_weight\": %d, "
+            "\"error_weight\": %d, \"algo\": %d,\n",
+            INDEX, BLOCK_LENGTH, BLOCK_WEIGHT, ERROR_WEIGHT, ALGO);
+#ifdef __VERSION__
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    fprintf(out, "  \"unit\": \"cycles\",\n");
+#else
+    fprintf(out, "  \"unit\": \"ns\",\n");
+#endif
+#ifdef AVX
+    fprintf(out, "  \"avx\": true,\n");
+#else
+    fprintf(out, "  \"avx\": false,\n");
+#endif
+#ifdef JIT
+    fprintf(out, "  \"jit\": true,\n");
+#else
+    fprintf(out, "  \"jit\": false,\n");
+#endif
+    fprintf(out, "  \"kernels\": [");
+
+    bench_syndrome(&H, &e, calls);
+    bench_counters(&H, &e, calls);
+#if (ALGO != BP)
+    bench_single(&H, &e, calls * 100, &prng);
+#endif
+    bench_threshold(calls * 100, &prng);
+    bench_random(&H, calls, &prng);
+
+    fprintf(out, "\n  ]\n}\n");
+    if (output)
+        fclose(out);
+
+    if (failures)
+        fprintf(stderr, "%d kernels differ from their reference\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
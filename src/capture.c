@@ -0,0 +1,313 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture.h"
+
+/* File layout (native byte order):
+ *   char     magic[8]
+ *   uint32_t version
+ *   uint32_t length of the parameters string
+ *   uint32_t size of a record
+ *   uint32_t reserved (zero)
+ *   char     params[length] (not null-terminated, padded with zeros to a
+ *            multiple of 8 bytes)
+ *   records[] (up to the end of the file), struct capture_record for capture
+ *   files
+ */
+static const char magic[8] = "QCMDPCF";
+
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t params_length;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+/* Single producer (a decoding thread), single consumer (the writer thread)
+ * ring of records */
+struct ring {
+    /* 'ring_size' records of 'record_size' bytes */
+    char *records;
+    /* Records are added at 'head' and removed at 'tail' */
+    atomic_ulong head;
+    atomic_ulong tail;
+    /* Records lost because the ring was full, only written by the producer */
+    atomic_long dropped;
+} __attribute__((aligned(64)));
+
+struct capture {
+    FILE *f;
+    size_t record_size;
+    unsigned long ring_size;
+    int n_threads;
+    struct ring *rings;
+    pthread_t writer;
+    atomic_int run;
+    /* Written by the writer thread only */
+    long int written;
+    int error;
+};
+
+/* Write the records of all the rings to the file. Returns the number of
+ * records written. */
+static long int drain(struct capture *c) {
+    long int n = 0;
+    for (int i = 0; i < c->n_threads; ++i) {
+        struct ring *r = &c->rings[i];
+        unsigned long tail =
+            atomic_load_explicit(&r->tail, memory_order_relaxed);
+        unsigned long head =
+            atomic_load_explicit(&r->head, memory_order_acquire);
+        for (; tail != head; ++tail, ++n) {
+            if (!c->error &&
+                fwrite(r->records + (tail % c->ring_size) * c->record_size,
+                       c->record_size, 1, c->f) != 1)
+                c->error = 1;
+            atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+        }
+    }
+    c->written += n;
+    return n;
+}
+
+static void *writer(void *arg) {
+    struct capture *c = arg;
+    const struct timespec idle = {0, 10000000};
+
+    while (atomic_load(&c->run)) {
+        if (!drain(c)) {
+            fflush(c->f);
+            nanosleep(&idle, NULL);
+        }
+    }
+    /* The decoding threads are done. */
+    drain(c);
+    return NULL;
+}
+
+/* Create the file 'filename' of records of 'record_size' bytes, identified by
+ * 'file_magic' and 'version', and start the writer thread. Each thread buffers
+ * up to 'ring_size' records (a power of two). Returns NULL on failure. */
+struct capture *capture_open_records(const char *filename,
+                                     const char file_magic[8],
+                                     uint32_t version, const char *params,
+                                     size_t record_size,
+                                     unsigned long ring_size, int n_threads) {
+    struct capture *c = malloc(sizeof(struct capture));
+    if (!c)
+        return NULL;
+    c->f = fopen(filename, "wb");
+    if (!c->f) {
+        free(c);
+        return NULL;
+    }
+
+    struct header h = {0};
+    memcpy(h.magic, file_magic, sizeof(h.magic));
+    h.version = version;
+    h.params_length = strlen(params);
+    h.record_size = record_size;
+    const char padding[8] = {0};
+    if (fwrite(&h, sizeof(h), 1, c->f) != 1 ||
+        fwrite(params, 1, h.params_length, c->f) != h.params_length ||
+        fwrite(padding, 1, -h.params_length % 8, c->f) !=
+            -h.params_length % 8) {
+        fclose(c->f);
+        free(c);
+        return NULL;
+    }
+
+    c->record_size = record_size;
+    c->ring_size = ring_size;
+    c->n_threads = n_threads;
+    c->rings = aligned_alloc(64, n_threads * sizeof(struct ring));
+    int ok = c->rings != NULL;
+    for (int i = 0; ok && i < n_threads; ++i) {
+        c->rings[i].records = aligned_alloc(64, ring_size * record_size);
+        atomic_init(&c->rings[i].head, 0);
+        atomic_init(&c->rings[i].tail, 0);
+        atomic_init(&c->rings[i].dropped, 0);
+        if (!c->rings[i].records) {
+            c->n_threads = i;
+            ok = 0;
+        }
+    }
+    c->written = 0;
+    c->error = 0;
+    atomic_init(&c->run, 1);
+
+    /* Signals are handled by the main thread. */
+    if (ok) {
+        sigset_t set;
+        sigset_t oldset;
+        sigfillset(&set);
+        pthread_sigmask(SIG_BLOCK, &set, &oldset);
+        ok = !pthread_create(&c->writer, NULL, writer, c);
+        pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    }
+    if (!ok) {
+        /* Without the writer, every record would be dropped. */
+        fclose(c->f);
+        if (c->rings)
+            for (int i = 0; i < c->n_threads; ++i)
+                free(c->rings[i].records);
+        free(c->rings);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+/* Create the capture file 'filename'. Returns NULL on failure. */
+struct capture *capture_open(const char *filename, const char *params,
+                             int n_threads) {
+    return capture_open_records(filename, magic, CAPTURE_VERSION, params,
+                                sizeof(struct capture_record), CAPTURE_RING,
+                                n_threads);
+}
+
+/* Record to fill by thread 'tid', then to be committed with capture_commit.
+ * Never blocks, returns NULL (and counts the record as dropped) when the ring
+ * of the thread is full. */
+void *capture_reserve_record(struct capture *c, int tid) {
+    struct ring *r = &c->rings[tid];
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) ==
+        c->ring_size) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+    return r->records + (head % c->ring_size) * c->record_size;
+}
+
+struct capture_record *capture_reserve(struct capture *c, int tid) {
+    return capture_reserve_record(c, tid);
+}
+
+void capture_commit(struct capture *c, int tid) {
+    struct ring *r = &c->rings[tid];
+    atomic_fetch_add_explicit(&r->head, 1, memory_order_release);
+}
+
+/* Write the remaining records and close the file, once the decoding threads
+ * are done. Returns 0 if all the records reached the file. */
+int capture_close(struct capture *c, long int *written, long int *dropped) {
+    atomic_store(&c->run, 0);
+    pthread_join(c->writer, NULL);
+
+    *dropped = 0;
+    for (int i = 0; i < c->n_threads; ++i)
+        *dropped += atomic_load(&c->rings[i].dropped);
+    *written = c->written;
+
+    int ret = c->error;
+    if (fclose(c->f))
+        ret = 1;
+    for (int i = 0; i < c->n_threads; ++i)
+        free(c->rings[i].records);
+    free(c->rings);
+    free(c);
+    return ret ? -1 : 0;
+}
+
+/* Whether the parameter 'name' has the same value in both parameters
+ * strings. */
+static int same_parameter(const char *params1, const char *params2,
+                          const char *name) {
+    char token[64];
+    snprintf(token, sizeof(token), "-D%s=", name);
+    const char *v1 = strstr(params1, token);
+    const char *v2 = strstr(params2, token);
+    if (!v1 || !v2)
+        return 0;
+    size_t l1 = strcspn(v1, " ");
+    return l1 == strcspn(v2, " ") && !strncmp(v1, v2, l1);
+}
+
+/* Map the capture file 'filename', whose instances must have the dimensions of
+ * the parameters 'params' (the decoder may differ). Returns 0 on success. */
+int corpus_open(const char *filename, const char *params, struct corpus *c) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct header)) {
+        close(fd);
+        return -1;
+    }
+    c->size = st.st_size;
+    c->map = mmap(NULL, c->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (c->map == MAP_FAILED)
+        return -1;
+
+    /* The lengths come from the file, check them before using them. */
+    const struct header *h = c->map;
+    size_t params_length = h->params_length;
+    size_t offset = 0;
+    int ok = !memcmp(h->magic, magic, sizeof(magic)) &&
+             h->version == CAPTURE_VERSION &&
+             h->record_size == sizeof(struct capture_record) &&
+             params_length <= c->size - sizeof(struct header);
+    if (ok) {
+        offset = sizeof(struct header) + (params_length + 7) / 8 * 8;
+        /* A truncated file ends with a partial record. */
+        ok = offset <= c->size &&
+             (c->size - offset) % sizeof(struct capture_record) == 0;
+    }
+    const char *names[] = {"INDEX", "BLOCK_LENGTH", "BLOCK_WEIGHT",
+                           "ERROR_WEIGHT", "OUROBOROS"};
+    char *file_params = ok ? malloc(params_length + 1) : NULL;
+    ok = file_params != NULL;
+    if (ok) {
+        memcpy(file_params, (const char *)c->map + sizeof(struct header),
+               params_length);
+        file_params[params_length] = '\0';
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+            ok &= same_parameter(params, file_params, names[i]);
+    }
+    free(file_params);
+    if (!ok) {
+        munmap(c->map, c->size);
+        return -1;
+    }
+
+    c->records =
+        (const struct capture_record *)((const char *)c->map + offset);
+    c->count = (c->size - offset) / sizeof(struct capture_record);
+    madvise(c->map, c->size, MADV_WILLNEED);
+    return 0;
+}
+
+void corpus_close(struct corpus *c) { munmap(c->map, c->size); }
@@ -0,0 +1,357 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "latency.h"
+#include "param.h"
+
+/* File layout (native byte order):
+ *   char     magic[8]
+ *   uint32_t version
+ *   uint32_t length of the parameters string
+ *   int32_t  max_iter
+ *   uint32_t reserved (zero)
+ *   int64_t  n_test
+ *   int64_t  n_success
+ *   uint64_t seed
+ *   int64_t  first
+ *   int64_t  shard_index
+ *   int64_t  shard_count
+ *   int64_t  next
+ *   int64_t  syndrome_length
+ *   int64_t  error_length
+ *   int64_t  latency_length
+ *   int64_t  fail_blocked
+ *   int64_t  n_campaigns
+ *   int64_t  key_errors
+ *   char     params[length] (not null-terminated)
+ *   int64_t  n_iter[max_iter + 1]
+ *   int64_t  fail_syndrome[syndrome_length]
+ *   int64_t  fail_error[error_length]
+ *   int64_t  fail_stall[max_iter + 1]
+ *   int64_t  latency[latency_length]
+ *   struct campaign_record campaigns[n_campaigns]
+ */
+static const char magic[8] = "QCMDPCR";
+
+#define LATENCY_LENGTH (LATENCY_KINDS * LATENCY_BUCKETS)
+
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t params_length;
+    int32_t max_iter;
+    uint32_t reserved;
+    int64_t n_test;
+    int64_t n_success;
+    uint64_t seed;
+    int64_t first;
+    int64_t shard_index;
+    int64_t shard_count;
+    int64_t next;
+    int64_t syndrome_length;
+    int64_t error_length;
+    int64_t latency_length;
+    int64_t fail_blocked;
+    int64_t n_campaigns;
+    int64_t key_errors;
+};
+
+struct campaign_record {
+    uint64_t seed;
+    int64_t first;
+    int64_t shard_index;
+    int64_t shard_count;
+    int64_t next;
+};
+
+static void checkpoint_alloc(struct checkpoint *cp, const char *params,
+                             int max_iter, long int syndrome_length,
+                             long int error_length) {
+    cp->params = strdup(params);
+    cp->max_iter = max_iter;
+    cp->key_errors = 0;
+    cp->n_test = 0;
+    cp->n_success = 0;
+    cp->n_iter = calloc(max_iter + 1, sizeof(long int));
+    cp->syndrome_length = syndrome_length;
+    cp->error_length = error_length;
+    cp->fail_blocked = 0;
+    cp->fail_syndrome = calloc(syndrome_length, sizeof(long int));
+    cp->fail_error = calloc(error_length, sizeof(long int));
+    cp->fail_stall = calloc(max_iter + 1, sizeof(long int));
+    cp->latency = calloc(LATENCY_LENGTH, sizeof(long int));
+    cp->seed = 0;
+    cp->first = 0;
+    cp->shard_index = 0;
+    cp->shard_count = 0;
+    cp->next = 0;
+    cp->n_campaigns = 0;
+    cp->campaigns = NULL;
+}
+
+/* Empty results with the parameters the program was compiled with */
+void checkpoint_init(struct checkpoint *cp, const char *params, int max_iter) {
+    checkpoint_alloc(cp, params, max_iter, BLOCK_LENGTH + 1,
+                     INDEX * BLOCK_LENGTH + 1);
+}
+
+/* Empty results with the same parameters as 'src' */
+void checkpoint_init_from(struct checkpoint *cp, const struct checkpoint *src) {
+    checkpoint_alloc(cp, src->params, src->max_iter, src->syndrome_length,
+                     src->error_length);
+    cp->key_errors = src->key_errors;
+}
+
+void checkpoint_clear(struct checkpoint *cp) {
+    free(cp->params);
+    free(cp->n_iter);
+    free(cp->fail_syndrome);
+    free(cp->fail_error);
+    free(cp->fail_stall);
+    free(cp->latency);
+    free(cp->campaigns);
+    cp->params = NULL;
+    cp->n_iter = NULL;
+    cp->fail_syndrome = NULL;
+    cp->fail_error = NULL;
+    cp->fail_stall = NULL;
+    cp->latency = NULL;
+    cp->n_campaigns = 0;
+    cp->campaigns = NULL;
+}
+
+static int write_array(FILE *f, const long int *a, long int length) {
+    for (long int i = 0; i < length; ++i) {
+        int64_t x = a[i];
+        if (fwrite(&x, sizeof(x), 1, f) != 1)
+            return -1;
+    }
+    return 0;
+}
+
+static int read_array(FILE *f, long int *a, long int length) {
+    for (long int i = 0; i < length; ++i) {
+        int64_t x;
+        if (fread(&x, sizeof(x), 1, f) != 1)
+            return -1;
+        a[i] = x;
+    }
+    return 0;
+}
+
+/* Write the results to a temporary file, then rename it so that 'filename'
+ * always holds a complete result file. Returns 0 on success. */
+int checkpoint_save(const char *filename, const struct checkpoint *cp) {
+    struct header h = {0};
+    memcpy(h.magic, magic, sizeof(magic));
+    h.version = CHECKPOINT_VERSION;
+    h.params_length = strlen(cp->params);
+    h.max_iter = cp->max_iter;
+    h.n_test = cp->n_test;
+    h.n_success = cp->n_success;
+    h.seed = cp->seed;
+    h.first = cp->first;
+    h.shard_index = cp->shard_index;
+    h.shard_count = cp->shard_count;
+    h.next = cp->next;
+    h.syndrome_length = cp->syndrome_length;
+    h.error_length = cp->error_length;
+    h.latency_length = LATENCY_LENGTH;
+    h.fail_blocked = cp->fail_blocked;
+    h.n_campaigns = cp->n_campaigns;
+    h.key_errors = cp->key_errors;
+
+    size_t length = strlen(filename) + sizeof(".tmp");
+    char tmp[length];
+    snprintf(tmp, length, "%s.tmp", filename);
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+        return -1;
+
+    int ret = 0;
+    if (fwrite(&h, sizeof(h), 1, f) != 1 ||
+        fwrite(cp->params, 1, h.params_length, f) != h.params_length ||
+        write_array(f, cp->n_iter, cp->max_iter + 1) ||
+        write_array(f, cp->fail_syndrome, cp->syndrome_length) ||
+        write_array(f, cp->fail_error, cp->error_length) ||
+        write_array(f, cp->fail_stall, cp->max_iter + 1) ||
+        write_array(f, cp->latency, LATENCY_LENGTH))
+        ret = -1;
+    for (long int i = 0; !ret && i < cp->n_campaigns; ++i) {
+        const struct campaign *c = &cp->campaigns[i];
+        struct campaign_record r = {c->seed, c->first, c->shard_index,
+                                    c->shard_count, c->next};
+        if (fwrite(&r, sizeof(r), 1, f) != 1)
+            ret = -1;
+    }
+    if (fflush(f) || fsync(fileno(f)))
+        ret = -1;
+    if (fclose(f))
+        ret = -1;
+
+    if (!ret && rename(tmp, filename))
+        ret = -1;
+    if (ret)
+        remove(tmp);
+    return ret;
+}
+
+/* Read a result file into 'cp', which must then be cleared with
+ * checkpoint_clear. Returns 0 on success. */
+int checkpoint_load(const char *filename, struct checkpoint *cp) {
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return -1;
+
+    struct header h;
+    if (fread(&h, sizeof(h), 1, f) != 1 ||
+        memcmp(h.magic, magic, sizeof(magic)) ||
+        h.version != CHECKPOINT_VERSION || h.max_iter < 0 ||
+        h.syndrome_length < 1 || h.error_length < 1 ||
+        h.latency_length != LATENCY_LENGTH || h.n_campaigns < 0 ||
+        h.key_errors < 0) {
+        fclose(f);
+        return -1;
+    }
+
+    char params[h.params_length + 1];
+    if (fread(params, 1, h.params_length, f) != h.params_length) {
+        fclose(f);
+        return -1;
+    }
+    params[h.params_length] = '\0';
+
+    checkpoint_alloc(cp, params, h.max_iter, h.syndrome_length,
+                     h.error_length);
+    cp->key_errors = h.key_errors;
+    cp->n_test = h.n_test;
+    cp->n_success = h.n_success;
+    cp->seed = h.seed;
+    cp->first = h.first;
+    cp->shard_index = h.shard_index;
+    cp->shard_count = h.shard_count;
+    cp->next = h.next;
+    cp->fail_blocked = h.fail_blocked;
+    if (read_array(f, cp->n_iter, cp->max_iter + 1) ||
+        read_array(f, cp->fail_syndrome, cp->syndrome_length) ||
+        read_array(f, cp->fail_error, cp->error_length) ||
+        read_array(f, cp->fail_stall, cp->max_iter + 1) ||
+        read_array(f, cp->latency, LATENCY_LENGTH)) {
+        checkpoint_clear(cp);
+        fclose(f);
+        return -1;
+    }
+    cp->n_campaigns = h.n_campaigns;
+    cp->campaigns = malloc(h.n_campaigns * sizeof(struct campaign));
+    for (long int i = 0; i < h.n_campaigns; ++i) {
+        struct campaign_record r;
+        if (fread(&r, sizeof(r), 1, f) != 1) {
+            checkpoint_clear(cp);
+            fclose(f);
+            return -1;
+        }
+        cp->campaigns[i] = (struct campaign){r.seed, r.first, r.shard_index,
+                                             r.shard_count, r.next};
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/* Add the results of 'src' to 'dst', which must have the same parameters. */
+void checkpoint_add(struct checkpoint *dst, const struct checkpoint *src) {
+    dst->n_test += src->n_test;
+    dst->n_success += src->n_success;
+    for (int it = 0; it <= dst->max_iter; ++it) {
+        dst->n_iter[it] += src->n_iter[it];
+        dst->fail_stall[it] += src->fail_stall[it];
+    }
+    dst->fail_blocked += src->fail_blocked;
+    for (long int w = 0; w < dst->syndrome_length; ++w)
+        dst->fail_syndrome[w] += src->fail_syndrome[w];
+    for (long int w = 0; w < dst->error_length; ++w)
+        dst->fail_error[w] += src->fail_error[w];
+    for (long int b = 0; b < LATENCY_LENGTH; ++b)
+        dst->latency[b] += src->latency[b];
+}
+
+/* Whether campaigns 'a' and 'b' have instances in common. */
+static int campaigns_overlap(const struct campaign *a,
+                             const struct campaign *b) {
+    if (a->seed != b->seed || !a->next || !b->next)
+        return 0;
+    long int a0 = a->first + a->shard_index;
+    long int b0 = b->first + b->shard_index;
+    long int a_last = a0 + (a->next - 1) * a->shard_count;
+    long int b_last = b0 + (b->next - 1) * b->shard_count;
+    long int last = a_last < b_last ? a_last : b_last;
+    /* Instances of 'a' from b0 on, their remainders modulo b->shard_count
+     * repeat after at most b->shard_count of them. */
+    long int n = a0 >= b0 ? 0 : (b0 - a0 + a->shard_count - 1) / a->shard_count;
+    for (long int k = 0; k < b->shard_count; ++k, ++n) {
+        long int index = a0 + n * a->shard_count;
+        if (index > last)
+            return 0;
+        if ((index - b0) % b->shard_count == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Add the results of 'src' to 'dst'. Returns 0 on success, -1 if the results
+ * were not obtained with the same parameters (or the same number of errors by
+ * key, which changes the meaning of the indices), -2 if they have instances in
+ * common. */
+int checkpoint_merge(struct checkpoint *dst, const struct checkpoint *src) {
+    if (strcmp(dst->params, src->params) || dst->max_iter != src->max_iter ||
+        dst->key_errors != src->key_errors ||
+        dst->syndrome_length != src->syndrome_length ||
+        dst->error_length != src->error_length)
+        return -1;
+
+    /* Results of a single run are their own campaign. */
+    struct campaign own = {src->seed, src->first, src->shard_index,
+                           src->shard_count, src->next};
+    const struct campaign *campaigns =
+        src->shard_count ? &own : src->campaigns;
+    long int n_campaigns = src->shard_count ? 1 : src->n_campaigns;
+    for (long int i = 0; i < n_campaigns; ++i)
+        for (long int j = 0; j < dst->n_campaigns; ++j)
+            if (campaigns_overlap(&campaigns[i], &dst->campaigns[j]))
+                return -2;
+
+    dst->campaigns =
+        realloc(dst->campaigns,
+                (dst->n_campaigns + n_campaigns) * sizeof(struct campaign));
+    memcpy(dst->campaigns + dst->n_campaigns, campaigns,
+           n_campaigns * sizeof(struct campaign));
+    dst->n_campaigns += n_campaigns;
+    checkpoint_add(dst, src);
+    dst->shard_count = 0;
+    return 0;
+}
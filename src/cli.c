@@ -20,108 +20,538 @@
    IN THE SOFTWARE
 */
 #include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "affinity.h"
+#include "capture.h"
+#include "checkpoint.h"
+#include "confint.h"
+#include "errorgen.h"
+#include "histogram.h"
 #include "param.h"
+#include "profile.h"
 #include "qcmdpc_decoder.h"
+#include "stats.h"
+#include "trace.h"
+#include "xoshiro256plusplus.h"
+
+/* Maximum length of the parameters string */
+#define PARAMS_LENGTH 1024
 
 decoding_results_t *current_results = NULL;
 pthread_t *print_thread = NULL;
+/* Set on SIGHUP, the print thread then prints the results */
+volatile sig_atomic_t print_requested = 0;
+/* Result file written periodically, NULL if none */
+const char *checkpoint_file = NULL;
+/* Whether a checkpoint was started and not saved yet */
+int checkpoint_started = 0;
+int quiet = 0;
+/* Failed (and slow) instances are written to this file, NULL if none */
+const char *capture_file = NULL;
+long int capture_slow = 0;
+/* Instances are read from this capture file, NULL if none */
+const char *replay_file = NULL;
+/* Iterations of a fraction of the instances are written to this file, NULL if
+ * none */
+const char *trace_file = NULL;
+double trace_rate = 1;
+const char *histogram_file = NULL;
+double histogram_rate = 1;
+/* Statistics are published in this file every second, NULL if none */
+const char *stats_file = NULL;
+struct stats *stats = NULL;
+/* Campaign of instances to decode (see decoding_results_t) */
+uint64_t seed = 0;
+int seed_set = 0;
+long int first = 0;
+long int shard_index = 0;
+long int shard_count = 1;
+/* Importance sampling of the error patterns, disabled when tilt_set is 0 */
+tilt_t tilt;
+int tilt_set = 0;
+/* Multilevel splitting, disabled when split_levels is 0 */
+#define SPLIT_MAX_LEVELS 64
+struct split_level split[SPLIT_MAX_LEVELS];
+int split_levels = 0;
+int split_copies = 2;
+/* Stratified sampling, disabled when stratum_width is 0 */
+int stratum_width = 0;
+double stratum_min = 0.01;
+long int stratum_pilot = 10000;
+
+/* Placement of the threads, one policy per run in scaling mode */
+#define MAX_CPUS 1024
+int affinity[AFFINITY_POLICIES] = {AFFINITY_NONE};
+int n_affinity = 0;
+int cpus[MAX_CPUS];
+/* Scaling mode: decode the same instances with 1, 2, 4, ... threads */
+int scaling = 0;
+
+/* Stopping rule, criteria are disabled when zero */
+struct stop_rule {
+    /* Confidence level of the interval is 1 - alpha */
+    double alpha;
+    /* Maximum value of log2(upper) - log2(lower) */
+    double width;
+    /* Maximum value of max(upper - dfr, dfr - lower) / dfr */
+    double precision;
+    /* The failure rate is the proportion of instances not decoded in at most
+     * 'iter' iterations (-1 for the maximum number of iterations) */
+    int iter;
+    /* Wall-clock budget in seconds */
+    double time;
+} stop = {0.01, 0, 0, -1, 0};
+
+/* Reason why the simulation stopped */
+enum { STOP_COUNT, STOP_SIGNAL, STOP_WIDTH, STOP_PRECISION, STOP_TIME };
+volatile sig_atomic_t stop_reason = STOP_COUNT;
+struct timespec start_time;
 
 #define _GNU_SOURCE
 
+static void format_parameters(char *params, size_t size);
 static void print_parameters(FILE *f);
 static void print_usage(FILE *f, char *arg0);
+static void print_histogram(FILE *f, long int n_test, long int n_success,
+                            const long int *n_iter, int max_iter);
+static int parse_split(const char *arg);
+static void print_weighted(FILE *f);
+static void print_failures(FILE *f);
+static void print_latency(FILE *f);
+#if PROFILE
+static void print_profile(FILE *f);
+#endif
 static void print_stats(FILE *f);
+static void print_key(const decoding_results_t *res, long int key,
+                      long int n_test, long int n_success,
+                      const long int *n_iter);
+static void start_checkpoint(void);
+static int save_checkpoint(void);
+static void update_stats(int running);
+static void resume_checkpoint(decoding_results_t *res);
+static int merge(int argc, char *argv[]);
+static int parse_affinity(const char *arg);
+static void run_scaling(decoding_results_t *campaign, int max_threads);
+static int check_stop(void);
 static void inthandler(int signo);
 static void huphandler(int signo);
 static void parse_arguments(int argc, char *argv[], int *max_iter, long int *N,
-                            int *threads, int *quiet);
+                            int *threads, int *quiet, long int *key_errors,
+                            int *resume);
 
-static void print_parameters(FILE *f) {
+static void format_parameters(char *params, size_t size) {
     const char *algo[] = {"CLASSIC",  "BACKFLIP", "BACKFLIP2", "SBS", "GRAY_B",
                           "GRAY_BGF", "GRAY_BGB", "GRAY_BG",   "BP",  "SORT"};
 
-    fprintf(f,
-            "-DINDEX=%d "
-            "-DBLOCK_LENGTH=%d "
-            "-DBLOCK_WEIGHT=%d "
-            "-DERROR_WEIGHT=%d "
-            "-DOUROBOROS=%d "
-            "-DWEAK=%d "
-            "-DWEAK_P=%d "
-            "-DERROR_FLOOR=%d "
-            "-DERROR_FLOOR_P=%d "
+    snprintf(params, size,
+             "-DINDEX=%d "
+             "-DBLOCK_LENGTH=%d "
+             "-DBLOCK_WEIGHT=%d "
+             "-DERROR_WEIGHT=%d "
+             "-DOUROBOROS=%d "
+#if OUROBOROS
+             /* The decoders track the weight of the noisy syndrome, older
+              * results without this marker used the noiseless one. */
+             "-DOUROBOROS_WEIGHT=1 "
+#endif
+             "-DWEAK=%d "
+             "-DWEAK_P=%d "
+             "-DERROR_FLOOR=%d "
+             "-DERROR_FLOOR_P=%d "
 #if (ALGO == BP)
-            "-DBP_SCALE=%lg "
-            "-DBP_SATURATE=%lg "
+             "-DBP_SCALE=%lg "
+             "-DBP_SATURATE=%lg "
 #endif
 #if (ALGO == GRAY_B) || (ALGO == GRAY_BGF) || (ALGO == GRAY_BGB) ||            \
     (ALGO == GRAY_BG)
-            "-DTHRESHOLD_C0=%lg "
-            "-DTHRESHOLD_C1=%lg "
+             "-DTHRESHOLD_C0=%lg "
+             "-DTHRESHOLD_C1=%lg "
 #endif
 #if (ALGO == BACKFLIP2)
-            "-DTHRESHOLD_A0=%lg "
-            "-DTHRESHOLD_A1=%lg "
-            "-DTHRESHOLD_A2=%lg "
-            "-DTHRESHOLD_A3=%lg "
-            "-DTHRESHOLD_A4=%lg "
+             "-DTHRESHOLD_A0=%lg "
+             "-DTHRESHOLD_A1=%lg "
+             "-DTHRESHOLD_A2=%lg "
+             "-DTHRESHOLD_A3=%lg "
+             "-DTHRESHOLD_A4=%lg "
 #endif
 #if (ALGO == BACKFLIP)
-            "-DTTL_C0=%lg "
-            "-DTTL_C1=%lg "
+             "-DTTL_C0=%lg "
+             "-DTTL_C1=%lg "
 #endif
 #if (ALGO == BACKFLIP2) || (ALGO == BACKFLIP)
-            "-DTTL_SATURATE=%d "
+             "-DTTL_SATURATE=%d "
 #endif
 #if (ALGO == SORT)
-            "-DGRAY_SIZE=%d "
+             "-DGRAY_SIZE=%d "
+#endif
+#if BATCH
+             "-DBATCH=%d "
 #endif
-            "-DALGO=%s\n",
-            INDEX, BLOCK_LENGTH, BLOCK_WEIGHT, ERROR_WEIGHT, OUROBOROS, WEAK,
-            WEAK_P, ERROR_FLOOR, ERROR_FLOOR_P,
+             "-DALGO=%s",
+             INDEX, BLOCK_LENGTH, BLOCK_WEIGHT, ERROR_WEIGHT, OUROBOROS, WEAK,
+             WEAK_P, ERROR_FLOOR, ERROR_FLOOR_P,
 #if (ALGO == BP)
-            BP_SCALE, BP_SATURATE,
+             BP_SCALE, BP_SATURATE,
 #endif
 #if (ALGO == GRAY_B) || (ALGO == GRAY_BGF) || (ALGO == GRAY_BGB) ||            \
     (ALGO == GRAY_BG)
-            THRESHOLD_C0, THRESHOLD_C1,
+             THRESHOLD_C0, THRESHOLD_C1,
 #endif
 #if (ALGO == BACKFLIP2)
-            THRESHOLD_A0, THRESHOLD_A1, THRESHOLD_A2, THRESHOLD_A3,
-            THRESHOLD_A4,
+             THRESHOLD_A0, THRESHOLD_A1, THRESHOLD_A2, THRESHOLD_A3,
+             THRESHOLD_A4,
 #endif
 #if (ALGO == BACKFLIP)
-            TTL_C0, TTL_C1,
+             TTL_C0, TTL_C1,
 #endif
 #if (ALGO == BACKFLIP2) || (ALGO == BACKFLIP)
-            TTL_SATURATE,
+             TTL_SATURATE,
 #endif
 #if (ALGO == SORT)
-            GRAY_SIZE,
+             GRAY_SIZE,
 #endif
-            algo[ALGO]);
+#if BATCH
+             BATCH,
+#endif
+             algo[ALGO]);
+}
+
+static void print_parameters(FILE *f) {
+    char params[PARAMS_LENGTH];
+    format_parameters(params, sizeof(params));
+    fprintf(f, "%s\n", params);
     fflush(f);
 }
 
 static void print_usage(FILE *f, char *arg0) {
     fprintf(f,
             "usage: %s [OPTIONS]\n"
+            "       %s merge [-o OUTPUT] FILE...\n"
             "\n"
             "-i, --max-iter         maximum number of iterations\n"
-            "-N, --rounds           number of rounds to perform\n"
+            "-N, --rounds, --count  number of instances to decode\n"
             "-T, --threads          number of threads to use\n"
+            "-M, --errors-per-key   number of error patterns to decode with "
+            "each key\n"
+            "                       (-N is then the number of keys)\n"
+            "-s, --seed SEED        seed of the instances (random by "
+            "default)\n"
+            "-f, --first INDEX      index of the first instance\n"
+            "-S, --shard I/N        only decode the instances whose index "
+            "modulo N is I\n"
+            "                       (relative to the first instance)\n"
+            "-w, --stop-width W     stop when log2(upper) - log2(lower) <= W "
+            "for the\n"
+            "                       confidence interval of the DFR\n"
+            "-p, --stop-precision R stop when the confidence interval of the "
+            "DFR is within\n"
+            "                       a factor 1 +/- R of the DFR\n"
+            "-I, --stop-iter IT     compute the DFR for IT iterations instead "
+            "of the maximum\n"
+            "-a, --alpha ALPHA      confidence level of the interval is 1 - "
+            "ALPHA (0.01)\n"
+            "-t, --time-budget SEC  stop after SEC seconds\n"
+            "-e, --tilt THETA       importance sampling of the error "
+            "patterns, tilted by\n"
+            "                       exp(THETA * l) with l their intersection "
+            "with a column\n"
+            "-L, --split LEVELS     multilevel splitting (SBS and SORT), "
+            "LEVELS is a list\n"
+            "                       ITER:WEIGHT,... of syndrome weights at "
+            "given iterations\n"
+            "-K, --split-copies K   copies of a trajectory reaching a level "
+            "(2)\n"
+            "-g, --stratify WIDTH   stratified sampling by initial syndrome "
+            "weight, in strata\n"
+            "                       of WIDTH\n"
+            "-G, --stratify-min Q   minimum fraction of the instances of a "
+            "stratum to decode\n"
+            "                       (0.01)\n"
+            "-j, --stratify-pilot N number of pilot instances fixing the "
+            "fractions (10000)\n"
+            "-F, --capture FILE     write the failed instances to FILE\n"
+            "-X, --capture-slow IT  also write the instances decoded in at "
+            "least IT\n"
+            "                       iterations\n"
+            "-R, --replay FILE      decode the instances of the capture file "
+            "FILE\n"
+            "-Y, --trace FILE       write the state of the decoder after each "
+            "iteration to\n"
+            "                       FILE\n"
+            "-y, --trace-rate R     only trace a fraction R of the instances "
+            "(1)\n"
+            "-H, --counters FILE    write the distributions of the counters "
+            "in and out of\n"
+            "                       the error each time they are computed to "
+            "FILE\n"
+            "-D, --counters-rate R  only write the counters of a fraction R of "
+            "the instances\n"
+            "                       (1)\n"
+            "-A, --affinity POLICY  place the threads on the CPUs: none, "
+            "compact (SMT\n"
+            "                       siblings first) or scatter (one thread by "
+            "core first),\n"
+            "                       a list POLICY,... with --scaling\n"
+            "-C, --scaling          decode the instances with 1, 2, 4, ... up "
+            "to the number\n"
+            "                       of threads and compare the throughputs\n"
+            "-P, --stats FILE       publish the results in FILE (in /dev/shm "
+            "for shared\n"
+            "                       memory) every second, see qcmdpc_monitor\n"
+            "-c, --checkpoint FILE  regularly save the results to FILE\n"
+            "-r, --resume           resume from the results saved in the "
+            "checkpoint FILE\n"
             "-q, --quiet            do not regularly output results (only on "
-            "SIGHUP)\n",
-            arg0);
+            "SIGHUP)\n"
+            "\n"
+            "merge: sum the results of several checkpoint files and print "
+            "them\n"
+            "-o, --output FILE      also save the merged results to FILE\n",
+            arg0, arg0);
     exit(2);
 }
 
+static void print_histogram(FILE *f, long int n_test, long int n_success,
+                            const long int *n_iter, int max_iter) {
+    fprintf(f, "%ld", n_test);
+    for (int it = 0; it <= max_iter; ++it) {
+        if (n_iter[it])
+            fprintf(f, " %d:%ld", it, n_iter[it]);
+    }
+    if (n_success != n_test)
+        fprintf(f, " >%d:%ld", max_iter, n_test - n_success);
+    fprintf(f, "\n");
+}
+
+/* Parse the splitting levels "ITER:WEIGHT,ITER:WEIGHT,...", by increasing
+ * number of iterations. Returns 0 on success. */
+static int parse_split(const char *arg) {
+    split_levels = 0;
+    while (*arg) {
+        int n;
+        struct split_level *l = &split[split_levels];
+        if (split_levels == SPLIT_MAX_LEVELS ||
+            sscanf(arg, "%ld:%ld%n", &l->iter, &l->weight, &n) != 2 ||
+            l->iter < 1 || l->weight < 1 ||
+            (split_levels && l->iter <= split[split_levels - 1].iter))
+            return 1;
+        ++split_levels;
+        arg += n;
+        if (*arg == ',')
+            ++arg;
+        else if (*arg)
+            return 1;
+    }
+    return !split_levels;
+}
+
+/* Sums of the weights (and of their squares) of the instances by number of
+ * iterations, with importance sampling, splitting or stratified sampling. */
+static void print_weighted(FILE *f) {
+    int max_iter = current_results->max_iter;
+    long int n_test_total;
+    long int n_success_total;
+    long int n_iter_total[max_iter + 1];
+    double w1[max_iter + 2];
+    double w2[max_iter + 2];
+
+    sum_decoding_results(&n_test_total, &n_success_total, n_iter_total,
+                         current_results);
+    long int skipped;
+    sum_weighted_results(&skipped, w1, w2, current_results);
+
+    fprintf(f, "w %ld", n_test_total + skipped);
+    for (int it = 0; it <= max_iter; ++it) {
+        if (w1[it] > 0)
+            fprintf(f, " %d:%.17g:%.17g", it, w1[it], w2[it]);
+    }
+    if (w1[max_iter + 1] > 0)
+        fprintf(f, " >%d:%.17g:%.17g", max_iter, w1[max_iter + 1],
+                w2[max_iter + 1]);
+    fprintf(f, "\n");
+}
+
+#if PERF
+/* Rough machine balance of a core: instructions per cycle and bytes per cycle
+ * from the memory it can sustain. A phase fetching more bytes from the memory
+ * by instruction than their ratio is memory bound. */
+#define PERF_PEAK_IPC 4.
+#define PERF_PEAK_BYTES 8.
+/* Above these, a phase that is not memory bound is bound by the latency of the
+ * caches or by branch mispredictions. */
+#define PERF_L1D_MPKI 20.
+#define PERF_BRANCH_MPKI 5.
+
+/* Hardware events in each phase, with a roofline-style guess of what bounds
+ * it. */
+static void print_perf(FILE *f) {
+    uint64_t events[PROFILE_PHASES][PERF_EVENTS];
+    if (!sum_perf_results(events, current_results)) {
+        fprintf(f, "# perf unavailable\n");
+        return;
+    }
+    for (int p = 0; p < PROFILE_TOTAL; ++p) {
+        double instructions = events[p][PERF_INSTRUCTIONS];
+        double cycles = events[p][PERF_CYCLES];
+        if (instructions == 0 || cycles == 0)
+            continue;
+        double l1d = 1000. * events[p][PERF_L1D_MISSES] / instructions;
+        double llc = 1000. * events[p][PERF_LLC_MISSES] / instructions;
+        double branch = 1000. * events[p][PERF_BRANCH_MISSES] / instructions;
+        /* Cache lines brought from the memory */
+        double bytes_per_instruction = 64. * llc / 1000.;
+        const char *bound = "compute";
+        if (bytes_per_instruction > PERF_PEAK_BYTES / PERF_PEAK_IPC)
+            bound = "memory";
+        else if (l1d > PERF_L1D_MPKI)
+            bound = "cache";
+        else if (branch > PERF_BRANCH_MPKI)
+            bound = "branches";
+        fprintf(f,
+                "# perf %s ipc=%.2f l1d_mpki=%.2f llc_mpki=%.3f "
+                "branch_mpki=%.2f bytes_per_cycle=%.3f bound=%s\n",
+                profile_names[p], instructions / cycles, l1d, llc, branch,
+                64. * events[p][PERF_LLC_MISSES] / cycles, bound);
+    }
+}
+#endif
+
+#if PROFILE
+/* Average time spent in each phase by instance, and its share of the whole
+ * time of the threads (the remainder being the time spent elsewhere) */
+static void print_profile(FILE *f) {
+    uint64_t cycles[PROFILE_PHASES];
+    uint64_t count[PROFILE_PHASES];
+    sum_profile_results(cycles, count, current_results);
+    uint64_t instances = count[PROFILE_TOTAL];
+    if (!instances || !cycles[PROFILE_TOTAL])
+        return;
+
+    uint64_t other = cycles[PROFILE_TOTAL];
+    fprintf(f, "# profile");
+    for (int p = 0; p < PROFILE_TOTAL; ++p) {
+        if (!count[p])
+            continue;
+        other -= (cycles[p] < other) ? cycles[p] : other;
+        fprintf(f, " %s=%.0f(%.1f%%)", profile_names[p],
+                (double)cycles[p] / instances,
+                100. * cycles[p] / cycles[PROFILE_TOTAL]);
+    }
+    fprintf(f, " other=%.0f(%.1f%%) total=%.0f\n", (double)other / instances,
+            100. * other / cycles[PROFILE_TOTAL],
+            (double)cycles[PROFILE_TOTAL] / instances);
+#if PERF
+    print_perf(f);
+#endif
+}
+#endif
+
+/* Print the nonzero values of a histogram as "name=value:count,..." */
+static void print_counts(FILE *f, const char *name, const long int *counts,
+                         long int length) {
+    fprintf(f, " %s=", name);
+    const char *sep = "";
+    for (long int i = 0; i < length; ++i) {
+        if (counts[i]) {
+            fprintf(f, "%s%ld:%ld", sep, i, counts[i]);
+            sep = ",";
+        }
+    }
+}
+
+/* Final state of the failed instances: how many were blocked (no flip in their
+ * last iteration) and the histograms of their syndrome weight, of the weight
+ * of their remaining error and of the iteration where their syndrome weight
+ * was the smallest. */
+static void print_failure_counts(FILE *f, long int blocked,
+                                 const long int *syndrome,
+                                 const long int *error, const long int *stall,
+                                 int max_iter) {
+    long int failures = 0;
+    for (int it = 0; it <= max_iter; ++it)
+        failures += stall[it];
+    if (failures) {
+        fprintf(f, "# failures=%ld blocked=%ld", failures, blocked);
+        print_counts(f, "syndrome", syndrome, BLOCK_LENGTH + 1);
+        print_counts(f, "error", error, INDEX * BLOCK_LENGTH + 1);
+        print_counts(f, "stall", stall, max_iter + 1);
+        fprintf(f, "\n");
+    }
+}
+
+static void print_failures(FILE *f) {
+    int max_iter = current_results->max_iter;
+    long int blocked;
+    long int *syndrome = malloc((BLOCK_LENGTH + 1) * sizeof(long int));
+    long int *error = malloc((INDEX * BLOCK_LENGTH + 1) * sizeof(long int));
+    long int *stall = malloc((max_iter + 1) * sizeof(long int));
+    sum_failure_results(&blocked, syndrome, error, stall, current_results);
+    print_failure_counts(f, blocked, syndrome, error, stall, max_iter);
+    free(syndrome);
+    free(error);
+    free(stall);
+}
+
+/* Largest latency of the bucket reached by a fraction 'q' of the 'n'
+ * instances of histogram 'latency' */
+static uint64_t latency_percentile(const long int *latency, long int n,
+                                   double q) {
+    long int rank = ceil(q * n);
+    long int seen = 0;
+    int b = 0;
+    while (b < LATENCY_BUCKETS - 1 && (seen += latency[b]) < rank)
+        ++b;
+    return latency_lower(b + 1) - 1;
+}
+
+/* Distributions of the latencies (in cycles of the timestamp counter) of the
+ * setup and of the decoding of the instances, the percentiles are upper
+ * bounds and the buckets are given by their smallest latency. */
+static void print_latency_counts(FILE *f,
+                                 const long int (*latency)[LATENCY_BUCKETS]) {
+    static const char *const names[LATENCY_KINDS] = {"setup", "success",
+                                                     "failure"};
+    for (int k = 0; k < LATENCY_KINDS; ++k) {
+        long int n = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; ++b)
+            n += latency[k][b];
+        if (!n)
+            continue;
+        fprintf(f,
+                "# latency=%s n=%ld p50=%" PRIu64 " p99=%" PRIu64
+                " p99.9=%" PRIu64 " buckets=",
+                names[k], n, latency_percentile(latency[k], n, 0.5),
+                latency_percentile(latency[k], n, 0.99),
+                latency_percentile(latency[k], n, 0.999));
+        const char *sep = "";
+        for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+            if (latency[k][b]) {
+                fprintf(f, "%s%" PRIu64 ":%ld", sep, latency_lower(b),
+                        latency[k][b]);
+                sep = ",";
+            }
+        }
+        fprintf(f, "\n");
+    }
+}
+
+static void print_latency(FILE *f) {
+    long int(*latency)[LATENCY_BUCKETS] =
+        malloc(LATENCY_KINDS * sizeof(*latency));
+    sum_latency_results(latency, current_results);
+    print_latency_counts(f, (const long int(*)[LATENCY_BUCKETS])latency);
+    free(latency);
+}
+
 static void print_stats(FILE *f) {
     if (!current_results->n_test && !current_results->n_success)
         return;
@@ -132,38 +562,400 @@ static void print_stats(FILE *f) {
     sum_decoding_results(&n_test_total, &n_success_total, n_iter_total,
                          current_results);
 
-    fprintf(f, "%ld", n_test_total);
-    for (int it = 0; it <= current_results->max_iter; ++it) {
-        if (n_iter_total[it])
-            fprintf(f, " %d:%ld", it, n_iter_total[it]);
-    }
-    if (n_success_total != n_test_total)
-        fprintf(f, " >%d:%ld", current_results->max_iter,
-                n_test_total - n_success_total);
-    fprintf(f, "\n");
+    print_histogram(f, n_test_total, n_success_total, n_iter_total,
+                    current_results->max_iter);
+    if (weighted_results(current_results))
+        print_weighted(f);
+    print_failures(f);
+    print_latency(f);
+#if PROFILE
+    print_profile(f);
+#endif
     fflush(f);
 }
 
+/* Results of a single key, in per-key mode. */
+static void print_key(const decoding_results_t *res, long int key,
+                      long int n_test, long int n_success,
+                      const long int *n_iter) {
+    fprintf(stdout, "key=%ld ", key);
+    print_histogram(stdout, n_test, n_success, n_iter, res->max_iter);
+    fflush(stdout);
+}
+
+/* Seconds since the start of the simulation */
+static double elapsed_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec - start_time.tv_sec +
+           (now.tv_nsec - start_time.tv_nsec) * 1e-9;
+}
+
+static void update_stats(int running) {
+    if (!stats)
+        return;
+    long int n_test;
+    long int n_success;
+    long int n_iter[current_results->max_iter + 1];
+    long int thread_test[current_results->n_threads];
+    sum_decoding_results(&n_test, &n_success, n_iter, current_results);
+    thread_decoding_results(thread_test, current_results);
+    stats_update(stats, elapsed_time(), n_test, n_success, n_iter,
+                 thread_test, running);
+}
+
+/* Start a checkpoint, it is saved once all the instances handed out so far
+ * are decoded. */
+static void start_checkpoint(void) {
+    if (!checkpoint_file || checkpoint_started)
+        return;
+    decoder_checkpoint_start(current_results);
+    checkpoint_started = 1;
+}
+
+/* Save the checkpoint started if it is complete. Returns -1 if it cannot be
+ * completed (see decoder_checkpoint_collect). */
+static int save_checkpoint(void) {
+    if (!checkpoint_started)
+        return 0;
+
+    char params[PARAMS_LENGTH];
+    format_parameters(params, sizeof(params));
+
+    struct checkpoint cp;
+    checkpoint_init(&cp, params, current_results->max_iter);
+    cp.key_errors = current_results->key_errors;
+    int ret = decoder_checkpoint_collect(current_results, &cp);
+    if (ret)
+        checkpoint_started = 0;
+    if (ret == 1) {
+        cp.seed = current_results->seed;
+        cp.first = current_results->first;
+        cp.shard_index = current_results->shard_index;
+        cp.shard_count = current_results->shard_count;
+        if (checkpoint_save(checkpoint_file, &cp))
+            fprintf(stderr, "Could not write checkpoint file '%s'\n",
+                    checkpoint_file);
+    }
+    checkpoint_clear(&cp);
+    return ret;
+}
+
+/* Start from the results of the checkpoint file, if it exists. */
+static void resume_checkpoint(decoding_results_t *res) {
+    if (access(checkpoint_file, F_OK))
+        return;
+
+    struct checkpoint cp;
+    if (checkpoint_load(checkpoint_file, &cp)) {
+        fprintf(stderr, "Invalid checkpoint file '%s'\n", checkpoint_file);
+        exit(EXIT_FAILURE);
+    }
+
+    char params[PARAMS_LENGTH];
+    format_parameters(params, sizeof(params));
+    if (!cp.shard_count) {
+        fprintf(stderr, "Checkpoint file '%s' holds merged results\n",
+                checkpoint_file);
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(cp.params, params) || cp.max_iter != res->max_iter) {
+        fprintf(stderr,
+                "Checkpoint file '%s' was obtained with other parameters\n",
+                checkpoint_file);
+        exit(EXIT_FAILURE);
+    }
+    /* The saved indices are those of the keys in per-key mode. */
+    if (cp.key_errors != res->key_errors) {
+        fprintf(stderr,
+                "Checkpoint file '%s' was obtained with another number of "
+                "errors by key (-M %ld)\n",
+                checkpoint_file, cp.key_errors);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Continue the same campaign after the instances already decoded. */
+    res->seed = cp.seed;
+    res->first = cp.first;
+    res->shard_index = cp.shard_index;
+    res->shard_count = cp.shard_count;
+    atomic_store(&res->next, cp.next);
+
+    static struct checkpoint resumed;
+    resumed = cp;
+    res->resumed = &resumed;
+}
+
+/* Sum compatible result files, print the results like a simulation would. */
+static int merge(int argc, char *argv[]) {
+    const char *output = NULL;
+    const char *options = "o:";
+    static struct option longopts[] = {{"output", required_argument, 0, 'o'},
+                                       {NULL, 0, 0, 0}};
+
+    int ch;
+    while ((ch = getopt_long(argc, argv, options, longopts, NULL)) != -1) {
+        switch (ch) {
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            print_usage(stderr, argv[0]);
+            break;
+        }
+    }
+    if (optind >= argc)
+        print_usage(stderr, argv[0]);
+
+    struct checkpoint total;
+    for (int i = optind; i < argc; ++i) {
+        struct checkpoint cp;
+        if (checkpoint_load(argv[i], &cp)) {
+            fprintf(stderr, "Invalid checkpoint file '%s'\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        if (i == optind)
+            checkpoint_init_from(&total, &cp);
+        /* The same instances must not be counted twice. */
+        int merged = checkpoint_merge(&total, &cp);
+        if (merged == -1) {
+            fprintf(stderr,
+                    "Checkpoint file '%s' was obtained with other parameters "
+                    "or another number of errors by key\n",
+                    argv[i]);
+            return EXIT_FAILURE;
+        }
+        if (merged == -2) {
+            fprintf(stderr,
+                    "Checkpoint file '%s' holds results of instances of the "
+                    "previous files\n",
+                    argv[i]);
+            return EXIT_FAILURE;
+        }
+        checkpoint_clear(&cp);
+    }
+
+    printf("%s\n", total.params);
+    print_histogram(stdout, total.n_test, total.n_success, total.n_iter,
+                    total.max_iter);
+    print_failure_counts(stdout, total.fail_blocked, total.fail_syndrome,
+                         total.fail_error, total.fail_stall, total.max_iter);
+    print_latency_counts(stdout,
+                         (const long int(*)[LATENCY_BUCKETS])total.latency);
+
+    int ret = EXIT_SUCCESS;
+    if (output && checkpoint_save(output, &total)) {
+        fprintf(stderr, "Could not write checkpoint file '%s'\n", output);
+        ret = EXIT_FAILURE;
+    }
+    checkpoint_clear(&total);
+    return ret;
+}
+
+/* Parse the affinity policies "POLICY,POLICY,...". Returns 0 on success. */
+static int parse_affinity(const char *arg) {
+    n_affinity = 0;
+    while (*arg) {
+        size_t length = strcspn(arg, ",");
+        char name[16];
+        if (n_affinity == AFFINITY_POLICIES || length >= sizeof(name))
+            return 1;
+        memcpy(name, arg, length);
+        name[length] = '\0';
+        int policy = affinity_parse(name);
+        if (policy < 0)
+            return 1;
+        affinity[n_affinity++] = policy;
+        arg += length;
+        if (*arg == ',')
+            ++arg;
+    }
+    return !n_affinity;
+}
+
+/* Decode the instances of 'campaign' with 1, 2, 4, ... and max_threads
+ * threads, with each affinity policy, and print the throughputs, the
+ * efficiency (speedup over one thread divided by the number of threads) and
+ * the imbalance between the threads ((max - min) / mean instances). */
+static void run_scaling(decoding_results_t *campaign, int max_threads) {
+    for (int a = 0; a < (n_affinity ? n_affinity : 1); ++a) {
+        int n_cpus = affinity_cpus(affinity[a], cpus, MAX_CPUS);
+        if (affinity[a] != AFFINITY_NONE && !n_cpus) {
+            fprintf(stderr, "Affinity '%s' is not available\n",
+                    affinity_names[affinity[a]]);
+            continue;
+        }
+        double base = 0;
+        for (int t = 1; stop_reason == STOP_COUNT;
+             t = (2 * t < max_threads) ? 2 * t : max_threads) {
+            decoding_results_t res;
+            init_decoding_results(&res, t, campaign->max_iter);
+            res.seed = campaign->seed;
+            res.first = campaign->first;
+            res.count = campaign->count;
+            res.shard_index = campaign->shard_index;
+            res.shard_count = campaign->shard_count;
+            res.tilt = campaign->tilt;
+            res.split = campaign->split;
+            res.split_levels = campaign->split_levels;
+            res.split_copies = campaign->split_copies;
+            res.stratum_width = campaign->stratum_width;
+            res.stratum_min = campaign->stratum_min;
+            res.stratum_pilot = campaign->stratum_pilot;
+            res.corpus = campaign->corpus;
+            res.key_errors = campaign->key_errors;
+            res.cpus = cpus;
+            res.n_cpus = n_cpus;
+            current_results = &res;
+
+            double start = elapsed_time();
+            decoder_loop(&res, t);
+            double seconds = elapsed_time() - start;
+
+            long int test[t];
+            thread_decoding_results(test, &res);
+            long int total = 0;
+            long int min = test[0];
+            long int max = test[0];
+            for (int i = 0; i < t; ++i) {
+                total += test[i];
+                min = (test[i] < min) ? test[i] : min;
+                max = (test[i] > max) ? test[i] : max;
+            }
+            double rate = total / seconds;
+            if (t == 1)
+                base = rate;
+            printf("# scaling threads=%d affinity=%s instances=%ld "
+                   "seconds=%.3f rate=%.1f speedup=%.2f efficiency=%.2f "
+                   "imbalance=%.3f\n",
+                   t, affinity_names[affinity[a]], total, seconds, rate,
+                   rate / base, rate / base / t,
+                   total ? (double)(max - min) * t / total : 0.);
+            fflush(stdout);
+
+            current_results = campaign;
+            clear_decoding_results(&res);
+            if (t == max_threads)
+                break;
+        }
+    }
+}
+
+/* Returns the reason to stop the simulation early, STOP_COUNT to continue. */
+static int check_stop(void) {
+    if (stop.time > 0 && elapsed_time() >= stop.time)
+        return STOP_TIME;
+    if (stop.width <= 0 && stop.precision <= 0)
+        return STOP_COUNT;
+
+    long int n_test;
+    long int n_success;
+    long int n_iter[current_results->max_iter + 1];
+    sum_decoding_results(&n_test, &n_success, n_iter, current_results);
+
+    long int failures = n_test - n_success;
+    if (stop.iter >= 0)
+        for (int it = stop.iter + 1; it <= current_results->max_iter; ++it)
+            failures += n_iter[it];
+    /* The interval is meaningless until there are failures. */
+    if (failures == 0)
+        return STOP_COUNT;
+
+    double lower;
+    double upper;
+    double dfr = (double)failures / n_test;
+    if (weighted_results(current_results)) {
+        /* Normal interval for the mean of the weighted failures */
+        int max_iter = current_results->max_iter;
+        long int skipped;
+        double w1[max_iter + 2];
+        double w2[max_iter + 2];
+        sum_weighted_results(&skipped, w1, w2, current_results);
+        n_test += skipped;
+        double s1 = w1[max_iter + 1];
+        double s2 = w2[max_iter + 1];
+        if (stop.iter >= 0)
+            for (int it = stop.iter + 1; it <= max_iter; ++it) {
+                s1 += w1[it];
+                s2 += w2[it];
+            }
+        /* With splitting, the sums of squares are already cumulated. */
+        if (current_results->split_levels)
+            s2 = w2[(stop.iter >= 0) ? stop.iter + 1 : max_iter + 1];
+        if (n_test < 2)
+            return STOP_COUNT;
+        dfr = s1 / n_test;
+        double var = (s2 / n_test - dfr * dfr) / (n_test - 1);
+        double z = normal_quantile(1 - stop.alpha / 2);
+        lower = dfr - z * sqrt(var > 0 ? var : 0);
+        upper = dfr + z * sqrt(var > 0 ? var : 0);
+        if (lower <= 0)
+            return STOP_COUNT;
+    } else {
+        clopper_pearson(failures, n_test, stop.alpha, &lower, &upper);
+    }
+    if (stop.width > 0 && log2(upper) - log2(lower) <= stop.width)
+        return STOP_WIDTH;
+    if (stop.precision > 0 && upper - dfr <= stop.precision * dfr &&
+        dfr - lower <= stop.precision * dfr)
+        return STOP_PRECISION;
+    return STOP_COUNT;
+}
+
 static void inthandler(int signo) {
     (void)signo;
+    stop_reason = STOP_SIGNAL;
     if (print_thread)
         pthread_cancel(*print_thread);
     decoder_stop(current_results);
 }
 
+/* The results are printed by the print thread, printing them here could
+ * deadlock in stdio or malloc. */
 static void huphandler(int signo) {
     (void)signo;
-    print_stats(stdout);
+    print_requested = 1;
 }
 
 static void parse_arguments(int argc, char *argv[], int *max_iter, long int *N,
-                            int *threads, int *quiet) {
-    const char *options = "i:N:T:q";
-    static struct option longopts[] = {{"max-iter", required_argument, 0, 'i'},
-                                       {"rounds", required_argument, 0, 'N'},
-                                       {"threads", required_argument, 0, 'T'},
-                                       {"quiet", no_argument, 0, 'q'},
-                                       {NULL, 0, 0, 0}};
+                            int *threads, int *quiet, long int *key_errors,
+                            int *resume) {
+    const char *options =
+        "i:N:T:M:s:f:S:w:p:I:a:t:e:L:K:g:G:j:F:X:R:Y:y:H:D:A:CP:c:rq";
+    static struct option longopts[] = {
+        {"max-iter", required_argument, 0, 'i'},
+        {"rounds", required_argument, 0, 'N'},
+        {"count", required_argument, 0, 'N'},
+        {"threads", required_argument, 0, 'T'},
+        {"errors-per-key", required_argument, 0, 'M'},
+        {"seed", required_argument, 0, 's'},
+        {"first", required_argument, 0, 'f'},
+        {"shard", required_argument, 0, 'S'},
+        {"stop-width", required_argument, 0, 'w'},
+        {"stop-precision", required_argument, 0, 'p'},
+        {"stop-iter", required_argument, 0, 'I'},
+        {"alpha", required_argument, 0, 'a'},
+        {"time-budget", required_argument, 0, 't'},
+        {"tilt", required_argument, 0, 'e'},
+        {"split", required_argument, 0, 'L'},
+        {"split-copies", required_argument, 0, 'K'},
+        {"stratify", required_argument, 0, 'g'},
+        {"stratify-min", required_argument, 0, 'G'},
+        {"stratify-pilot", required_argument, 0, 'j'},
+        {"capture", required_argument, 0, 'F'},
+        {"capture-slow", required_argument, 0, 'X'},
+        {"replay", required_argument, 0, 'R'},
+        {"trace", required_argument, 0, 'Y'},
+        {"trace-rate", required_argument, 0, 'y'},
+        {"counters", required_argument, 0, 'H'},
+        {"counters-rate", required_argument, 0, 'D'},
+        {"affinity", required_argument, 0, 'A'},
+        {"scaling", no_argument, 0, 'C'},
+        {"stats", required_argument, 0, 'P'},
+        {"checkpoint", required_argument, 0, 'c'},
+        {"resume", no_argument, 0, 'r'},
+        {"quiet", no_argument, 0, 'q'},
+        {NULL, 0, 0, 0}};
 
     int ch;
     while ((ch = getopt_long(argc, argv, options, longopts, NULL)) != -1) {
@@ -183,6 +975,122 @@ static void parse_arguments(int argc, char *argv[], int *max_iter, long int *N,
             if (*threads <= 0)
                 print_usage(stderr, argv[0]);
             break;
+        case 'M':
+            *key_errors = atol(optarg);
+            if (*key_errors < 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            seed_set = 1;
+            break;
+        case 'f':
+            first = atol(optarg);
+            if (first < 0)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'S':
+            if (sscanf(optarg, "%ld/%ld", &shard_index, &shard_count) != 2 ||
+                shard_count < 1 || shard_index < 0 ||
+                shard_index >= shard_count)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'w':
+            stop.width = atof(optarg);
+            if (stop.width <= 0)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'p':
+            stop.precision = atof(optarg);
+            if (stop.precision <= 0)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'I':
+            stop.iter = atoi(optarg);
+            if (stop.iter < 0)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'a':
+            stop.alpha = atof(optarg);
+            if (stop.alpha <= 0 || stop.alpha >= 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 't':
+            stop.time = atof(optarg);
+            if (stop.time <= 0)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'e':
+            init_tilt(&tilt, atof(optarg));
+            tilt_set = 1;
+            break;
+        case 'L':
+            if (parse_split(optarg))
+                print_usage(stderr, argv[0]);
+            break;
+        case 'K':
+            split_copies = atoi(optarg);
+            if (split_copies < 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'g':
+            stratum_width = atoi(optarg);
+            if (stratum_width < 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'G':
+            stratum_min = atof(optarg);
+            if (stratum_min <= 0 || stratum_min > 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'j':
+            stratum_pilot = atol(optarg);
+            if (stratum_pilot < 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'F':
+            capture_file = optarg;
+            break;
+        case 'X':
+            capture_slow = atol(optarg);
+            if (capture_slow < 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'R':
+            replay_file = optarg;
+            break;
+        case 'Y':
+            trace_file = optarg;
+            break;
+        case 'y':
+            trace_rate = atof(optarg);
+            if (trace_rate <= 0 || trace_rate > 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'H':
+            histogram_file = optarg;
+            break;
+        case 'D':
+            histogram_rate = atof(optarg);
+            if (histogram_rate <= 0 || histogram_rate > 1)
+                print_usage(stderr, argv[0]);
+            break;
+        case 'A':
+            if (parse_affinity(optarg))
+                print_usage(stderr, argv[0]);
+            break;
+        case 'C':
+            scaling = 1;
+            break;
+        case 'P':
+            stats_file = optarg;
+            break;
+        case 'c':
+            checkpoint_file = optarg;
+            break;
+        case 'r':
+            *resume = 1;
+            break;
         case 'q':
             *quiet = 1;
             break;
@@ -191,19 +1099,115 @@ static void parse_arguments(int argc, char *argv[], int *max_iter, long int *N,
             break;
         }
     }
+    if (*resume && !checkpoint_file)
+        print_usage(stderr, argv[0]);
+    if (stop.iter > *max_iter)
+        print_usage(stderr, argv[0]);
+    if (stop.width > 0 || stop.precision > 0) {
+        /* The instances of a batch share their parity check matrix, their
+         * outcomes are not independent and the interval would be too
+         * narrow. */
+#if BATCH
+        fprintf(stderr, "Stopping on the confidence interval is not "
+                        "available with BATCH\n");
+        exit(2);
+#endif
+    }
+    /* The error patterns near codewords are not sampled from the nominal
+     * distribution and the checkpoints do not hold the likelihood ratios. */
+    if (tilt_set && (ERROR_FLOOR || checkpoint_file))
+        print_usage(stderr, argv[0]);
+    if (split_levels) {
+        /* Only the step-by-step decoders use randomness, copies of a
+         * trajectory of the other decoders would all be identical. The
+         * levels of SORT must be in its step-by-step phase. */
+#if ((ALGO != SBS) && (ALGO != SORT)) || BATCH
+        fprintf(stderr, "Splitting requires the SBS or SORT decoder\n");
+        exit(2);
+#endif
+        if ((ALGO == SORT && split[0].iter < INDEX * BLOCK_LENGTH) ||
+            split[split_levels - 1].iter >= *max_iter || checkpoint_file)
+            print_usage(stderr, argv[0]);
+    }
+    if (capture_slow && !capture_file)
+        print_usage(stderr, argv[0]);
+    /* Replayed instances have their own keys and error patterns. */
+    if (replay_file && (BATCH || *key_errors || tilt_set))
+        print_usage(stderr, argv[0]);
+    if (stratum_width) {
+        /* The batch decoder decodes all its lanes and belief propagation does
+         * not compute the syndrome weight. */
+#if (ALGO == BP) || BATCH
+        fprintf(stderr, "Stratified sampling is not available with BP nor "
+                        "BATCH\n");
+        exit(2);
+#endif
+        if (checkpoint_file)
+            print_usage(stderr, argv[0]);
+    }
+    if (trace_file) {
+        /* The batch decoder and belief propagation do not have the states
+         * traced. */
+#if (ALGO == BP) || BATCH
+        fprintf(stderr, "Tracing is not available with BP nor BATCH\n");
+        exit(2);
+#endif
+    }
+    else if (trace_rate != 1)
+        print_usage(stderr, argv[0]);
+    if (histogram_file) {
+        /* The batch decoder and belief propagation do not compute the
+         * counters of a single instance. */
+#if (ALGO == BP) || BATCH
+        fprintf(stderr, "Counter distributions are not available with BP nor "
+                        "BATCH\n");
+        exit(2);
+#endif
+    }
+    else if (histogram_rate != 1)
+        print_usage(stderr, argv[0]);
+    if (scaling) {
+        /* Each run decodes the same instances from scratch. */
+        if (*N <= 0 || checkpoint_file || *resume || stats_file ||
+            capture_file || trace_file || histogram_file)
+            print_usage(stderr, argv[0]);
+    }
+    else if (n_affinity > 1)
+        print_usage(stderr, argv[0]);
 }
 
 void *print(void *arg) {
     (void)arg;
+    int seconds = 0;
     do {
-        sleep(TIME_BETWEEN_PRINTS);
-        print_stats(stdout);
+        sleep(1);
+        int reason = check_stop();
+        if (reason != STOP_COUNT) {
+            stop_reason = reason;
+            decoder_stop(current_results);
+            break;
+        }
+        update_stats(1);
+        save_checkpoint();
+        int requested = print_requested;
+        if (requested)
+            print_requested = 0;
+        int periodic = !(++seconds % TIME_BETWEEN_PRINTS);
+        if (requested || (periodic && !quiet))
+            print_stats(stdout);
+        if (requested || periodic)
+            start_checkpoint();
     } while (current_results->run);
 
     return NULL;
 }
 
 int main(int argc, char *argv[]) {
+    if (argc > 1 && !strcmp(argv[1], "merge"))
+        return merge(argc - 1, argv + 1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
     struct sigaction action_hup;
     action_hup.sa_handler = huphandler;
     sigemptyset(&action_hup.sa_mask);
@@ -218,31 +1222,199 @@ int main(int argc, char *argv[]) {
     sigaction(SIGTERM, &action_int, NULL);
     sigaction(SIGHUP, &action_hup, NULL);
 
-    /* Number of test rounds */
+    /* Number of instances */
     long int r = -1;
-    int quiet = 0;
+    int resume = 0;
     int n_threads = 1;
     int max_iter = 100;
+    long int key_errors = 0;
     decoding_results_t results;
     current_results = &results;
 
-    parse_arguments(argc, argv, &max_iter, &r, &n_threads, &quiet);
+    parse_arguments(argc, argv, &max_iter, &r, &n_threads, &quiet,
+                    &key_errors, &resume);
     print_parameters(stdout);
 
     /* Keep independent statistics for all threads. */
     init_decoding_results(&results, n_threads, max_iter);
+    results.key_errors = key_errors;
+    results.key_callback = print_key;
+    if (!seed_set) {
+        uint64_t s[4];
+        seed_random(s);
+        seed = s[0];
+    }
+    results.seed = seed;
+    results.first = first;
+    results.count = r;
 
-    if (!quiet) {
-        print_thread = malloc(sizeof(pthread_t));
-        pthread_create(print_thread, NULL, print, (void *)NULL);
+    struct corpus corpus;
+    if (replay_file) {
+        char params[PARAMS_LENGTH];
+        format_parameters(params, sizeof(params));
+        if (corpus_open(replay_file, params, &corpus)) {
+            fprintf(stderr, "Invalid capture file '%s'\n", replay_file);
+            exit(EXIT_FAILURE);
+        }
+        if (first >= corpus.count) {
+            fprintf(stderr, "Capture file '%s' only has %ld instances\n",
+                    replay_file, corpus.count);
+            exit(EXIT_FAILURE);
+        }
+        if (r == -1 || first + r > corpus.count)
+            results.count = corpus.count - first;
+        results.corpus = &corpus;
+    }
+    results.shard_index = shard_index;
+    results.shard_count = shard_count;
+    if (tilt_set)
+        results.tilt = &tilt;
+    results.split = split;
+    results.split_levels = split_levels;
+    results.split_copies = split_copies;
+    results.stratum_width = stratum_width;
+    results.stratum_min = stratum_min;
+    results.stratum_pilot = stratum_pilot;
+    if (resume)
+        resume_checkpoint(&results);
+    printf("# seed=%" PRIu64 " first=%ld shard=%ld/%ld\n", results.seed,
+           results.first, results.shard_index, results.shard_count);
+    if (tilt_set)
+        printf("# tilt=%g\n", tilt.theta);
+    if (split_levels) {
+        printf("# split=");
+        for (int i = 0; i < split_levels; ++i)
+            printf("%s%ld:%ld", i ? "," : "", split[i].iter, split[i].weight);
+        printf(" copies=%d\n", split_copies);
+    }
+    if (stratum_width)
+        printf("# stratify=%d min=%g pilot=%ld\n", stratum_width, stratum_min,
+               stratum_pilot);
+    if (scaling) {
+        run_scaling(&results, n_threads);
+        if (replay_file)
+            corpus_close(&corpus);
+        clear_decoding_results(&results);
+        exit(EXIT_SUCCESS);
+    }
+    if (n_affinity && affinity[0] != AFFINITY_NONE) {
+        results.n_cpus = affinity_cpus(affinity[0], cpus, MAX_CPUS);
+        results.cpus = cpus;
+        if (!results.n_cpus) {
+            fprintf(stderr, "Affinity '%s' is not available\n",
+                    affinity_names[affinity[0]]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (capture_file) {
+        char params[PARAMS_LENGTH];
+        format_parameters(params, sizeof(params));
+        results.capture = capture_open(capture_file, params, n_threads);
+        if (!results.capture) {
+            fprintf(stderr, "Could not create capture file '%s'\n",
+                    capture_file);
+            exit(EXIT_FAILURE);
+        }
+        results.capture_slow = capture_slow;
+    }
+    if (trace_file) {
+        char params[PARAMS_LENGTH];
+        format_parameters(params, sizeof(params));
+        results.trace = trace_open(trace_file, params, n_threads);
+        if (!results.trace) {
+            fprintf(stderr, "Could not create trace file '%s'\n", trace_file);
+            exit(EXIT_FAILURE);
+        }
+        results.trace_rate = trace_rate;
+    }
+    if (histogram_file) {
+        char params[PARAMS_LENGTH];
+        format_parameters(params, sizeof(params));
+        results.histogram = histogram_open(histogram_file, params, n_threads);
+        if (!results.histogram) {
+            fprintf(stderr, "Could not create counter file '%s'\n",
+                    histogram_file);
+            exit(EXIT_FAILURE);
+        }
+        results.histogram_rate = histogram_rate;
+    }
+
+    if (stats_file) {
+        char params[PARAMS_LENGTH];
+        format_parameters(params, sizeof(params));
+        stats = stats_open(stats_file, params, n_threads, max_iter,
+                           results.seed);
+        if (!stats) {
+            fprintf(stderr, "Could not create statistics file '%s'\n",
+                    stats_file);
+            exit(EXIT_FAILURE);
+        }
+        update_stats(1);
     }
 
-    decoder_loop(&results, n_threads, r);
+    /* The print thread also prints the results on SIGHUP. The signals are
+     * handled by the main thread, so that they do not interrupt it. */
+    sigset_t set;
+    sigset_t oldset;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, &oldset);
+    print_thread = malloc(sizeof(pthread_t));
+    pthread_create(print_thread, NULL, print, (void *)NULL);
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
 
-    if (!quiet)
+    decoder_loop(&results, n_threads);
+
+    if (print_thread) {
         pthread_cancel(*print_thread);
+        pthread_join(*print_thread, NULL);
+    }
 
     print_stats(stdout);
+    /* All the threads stopped, a new checkpoint is complete at once. */
+    checkpoint_started = 0;
+    start_checkpoint();
+    if (save_checkpoint() == -1)
+        fprintf(stderr,
+                "The last key was not fully decoded, checkpoint file '%s' "
+                "keeps the previous results\n",
+                checkpoint_file);
+    if (stats) {
+        update_stats(0);
+        stats_close(stats);
+    }
+
+    if (results.capture) {
+        long int written;
+        long int dropped;
+        if (capture_close(results.capture, &written, &dropped))
+            fprintf(stderr, "Could not write capture file '%s'\n",
+                    capture_file);
+        printf("# captured=%ld dropped=%ld\n", written, dropped);
+    }
+    if (results.trace) {
+        long int written;
+        long int dropped;
+        if (capture_close(results.trace, &written, &dropped))
+            fprintf(stderr, "Could not write trace file '%s'\n", trace_file);
+        printf("# traced=%ld dropped=%ld\n", written, dropped);
+    }
+    if (results.histogram) {
+        long int written;
+        long int dropped;
+        if (capture_close(results.histogram, &written, &dropped))
+            fprintf(stderr, "Could not write counter file '%s'\n",
+                    histogram_file);
+        printf("# counters=%ld dropped=%ld\n", written, dropped);
+    }
+
+    if (replay_file)
+        corpus_close(&corpus);
+
+    const char *reasons[] = {"count", "signal", "width", "precision", "time"};
+    printf("# stop=%s\n", reasons[stop_reason]);
 
     clear_decoding_results(&results);
 
@@ -15,6 +15,22 @@ void transpose_rows(code_t *H) {
     }
 }
 
+/* Precompute, for each position, where the offsets of H wrap around. */
+void compute_key_data(key_data_t *key) {
+    for (index_t k = 0; k < INDEX; ++k) {
+        const index_t *columns = key->H.columns[k];
+        for (index_t l = 0; l < BLOCK_WEIGHT; ++l) {
+            key->columns_wrap[k][l] = columns[l] - BLOCK_LENGTH;
+        }
+        index_t l = BLOCK_WEIGHT;
+        for (index_t j = 0; j < BLOCK_LENGTH; ++j) {
+            while (l > 0 && j + columns[l - 1] >= BLOCK_LENGTH)
+                --l;
+            key->split[k][j] = l;
+        }
+    }
+}
+
 void compute_codeword(cw_t codeword, code_t *H, msg_t message) {
     memset(codeword, 0, INDEX * 2 * SIZE_AVX * sizeof(bit_t));
 #ifndef AVX
@@ -93,13 +109,14 @@ void error_sparse_to_dense(e_t *e_dense, const sparse_t e_sparse,
 void syndrome_add_sparse_error(syndrome_t *syndrome, const sparse_t e_sparse,
                                index_t weight) {
     for (index_t k = 0; k < weight; ++k) {
+        syndrome->weight += 1 - 2 * syndrome->vec[e_sparse[k]];
         syndrome->vec[e_sparse[k]] ^= 1;
     }
 }
 
 void generate_random_message(msg_t message, prng_t prng) {
     for (index_t i = 0; i < BLOCK_LENGTH; i += 64) {
-        index_t rand = prng->random_uint64_t(prng->s);
+        index_t rand = random_uint64_t(prng->s);
         for (index_t j = 0; j < 64 && i + j < BLOCK_LENGTH; ++j) {
             bit_t b = (rand >> j) & 1L;
             message[i + j] = b;
@@ -0,0 +1,124 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include <float.h>
+#include <math.h>
+
+#include "confint.h"
+
+#define BETACF_MAX_ITER 10000000
+#define BETACF_EPS 1e-15
+/* Number of bisection steps on the logarithm of the quantile */
+#define QUANTILE_STEPS 64
+
+static double betacf(double a, double b, double x);
+static double incomplete_beta(double a, double b, double x);
+static double beta_quantile(double a, double b, double q);
+
+/* Continued fraction of the incomplete beta function (modified Lentz's
+ * method) */
+static double betacf(double a, double b, double x) {
+    double c = 1.;
+    double d = 1. - (a + b) * x / (a + 1.);
+    if (fabs(d) < DBL_MIN)
+        d = DBL_MIN;
+    d = 1. / d;
+    double h = d;
+    for (long int m = 1; m <= BETACF_MAX_ITER; ++m) {
+        double aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1. + aa * d;
+        if (fabs(d) < DBL_MIN)
+            d = DBL_MIN;
+        c = 1. + aa / c;
+        if (fabs(c) < DBL_MIN)
+            c = DBL_MIN;
+        d = 1. / d;
+        h *= d * c;
+
+        aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1. + aa * d;
+        if (fabs(d) < DBL_MIN)
+            d = DBL_MIN;
+        c = 1. + aa / c;
+        if (fabs(c) < DBL_MIN)
+            c = DBL_MIN;
+        d = 1. / d;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.) < BETACF_EPS)
+            break;
+    }
+    return h;
+}
+
+/* Regularized incomplete beta function I_x(a, b) */
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0.)
+        return 0.;
+    if (x >= 1.)
+        return 1.;
+    double lbt = lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) +
+                 b * log1p(-x);
+    if (x < (a + 1.) / (a + b + 2.))
+        return exp(lbt) * betacf(a, b, x) / a;
+    return 1. - exp(lbt) * betacf(b, a, 1. - x) / b;
+}
+
+/* x such that I_x(a, b) = q, by bisection on log(x) */
+static double beta_quantile(double a, double b, double q) {
+    double lo = log(DBL_MIN);
+    double hi = 0.;
+    for (int i = 0; i < QUANTILE_STEPS; ++i) {
+        double mid = (lo + hi) / 2.;
+        if (incomplete_beta(a, b, exp(mid)) < q)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return exp((lo + hi) / 2.);
+}
+
+/* Clopper-Pearson interval with confidence level 1 - alpha for a proportion of
+ * 'failures' out of 'n' (same as the 'beta' method of statsmodels'
+ * proportion_confint used by the scripts). */
+void clopper_pearson(long int failures, long int n, double alpha,
+                     double *lower, double *upper) {
+    *lower = (failures == 0)
+                 ? 0.
+                 : beta_quantile(failures, n - failures + 1, alpha / 2);
+    *upper = (failures == n)
+                 ? 1.
+                 : beta_quantile(failures + 1, n - failures, 1 - alpha / 2);
+}
+
+/* z such that P(Z <= z) = q for a standard normal Z, by bisection */
+double normal_quantile(double q) {
+    double lo = -40.;
+    double hi = 40.;
+    for (int i = 0; i < QUANTILE_STEPS; ++i) {
+        double mid = (lo + hi) / 2.;
+        if (erfc(-mid / sqrt(2.)) / 2. < q)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return (lo + hi) / 2.;
+}
@@ -27,15 +27,93 @@
 
 #include "code.h"
 #include "decoder.h"
+#include "histogram.h"
+#ifdef JIT
+#include "jit.h"
+#endif
 #include "param.h"
+#include "profile.h"
 #include "threshold.h"
+#include "trace.h"
 
-static bit_t get_counter(decoder_t dec, index_t index, index_t position);
-static void flip_column(decoder_t dec, index_t index, index_t position);
+static void get_counters(decoder_t dec);
+static void histogram_counters(decoder_t dec);
 static void single_flip(decoder_t dec, index_t index, index_t position);
 
-static bit_t get_counter(decoder_t dec, index_t index, index_t position) {
+static void get_counters(decoder_t dec) {
+    PROFILE_BEGIN(PROFILE_COUNTERS);
+#if defined(JIT) && defined(AVX)
+    if (dec->key && dec->key->jit)
+        jit_compute_counters(dec->key->jit, dec->counters, dec->syndrome->vec);
+    else
+#endif
+        compute_counters(dec->counters, dec->syndrome->vec, dec->H);
+    PROFILE_END(PROFILE_COUNTERS);
+    if (dec->histogram)
+        histogram_counters(dec);
+}
+
+/* Record the distributions of the counters of the positions in and out of the
+ * remaining error, only called when they are sampled. Consecutive positions
+ * are counted in distinct histograms so that the increments of a same value
+ * do not wait for each other. */
+static void histogram_counters(decoder_t dec) {
+    struct histogram_target *h = dec->histogram;
+    struct histogram_record *r = capture_reserve_record(h->c, h->tid);
+    if (!r)
+        return;
+    uint32_t hist[4][2][BLOCK_WEIGHT + 1];
+    memset(hist, 0, sizeof(hist));
+    for (index_t k = 0; k < INDEX; ++k) {
+        const bit_t *counters = dec->counters[k];
+        const bit_t *e = dec->e->vec[k];
+        const bit_t *bits = dec->bits[k];
+        index_t j = 0;
+        for (; j + 4 <= BLOCK_LENGTH; j += 4) {
+            ++hist[0][e[j] ^ bits[j]][counters[j]];
+            ++hist[1][e[j + 1] ^ bits[j + 1]][counters[j + 1]];
+            ++hist[2][e[j + 2] ^ bits[j + 2]][counters[j + 2]];
+            ++hist[3][e[j + 3] ^ bits[j + 3]][counters[j + 3]];
+        }
+        for (; j < BLOCK_LENGTH; ++j)
+            ++hist[0][e[j] ^ bits[j]][counters[j]];
+    }
+    r->index = h->index;
+    r->iter = dec->iter;
+    r->syndrome_weight = dec->syndrome->weight;
+    r->e_weight = dec->e->weight;
+    r->reserved = 0;
+    for (index_t v = 0; v <= BLOCK_WEIGHT; ++v) {
+        r->in_error[v] = hist[0][1][v] + hist[1][1][v] + hist[2][1][v] +
+                         hist[3][1][v];
+        r->out_error[v] = hist[0][0][v] + hist[1][0][v] + hist[2][0][v] +
+                          hist[3][0][v];
+    }
+    capture_commit(h->c, h->tid);
+}
+
+/* Counter of a single position, from the current syndrome */
+bit_t get_counter(decoder_t dec, index_t index, index_t position) {
     bit_t counter = 0;
+    if (dec->key) {
+#ifdef JIT
+        if (dec->key->jit)
+            return dec->key->jit->counter[index](
+                dec->syndrome->vec + position,
+                dec->key->split[index][position]);
+#endif
+        const index_t *columns = dec->key->H.columns[index];
+        const index_t *columns_wrap = dec->key->columns_wrap[index];
+        const bit_t *syndrome = dec->syndrome->vec + position;
+        index_t split = dec->key->split[index][position];
+
+        for (index_t l = 0; l < split; ++l)
+            counter += syndrome[columns[l]];
+        for (index_t l = split; l < BLOCK_WEIGHT; ++l)
+            counter += syndrome[columns_wrap[l]];
+        return counter;
+    }
+
     index_t offset = position;
 
     index_t l;
@@ -54,7 +132,29 @@ static bit_t get_counter(decoder_t dec, index_t index, index_t position) {
     return counter;
 }
 
-static void flip_column(decoder_t dec, index_t index, index_t position) {
+/* Flip the syndrome bits of a single column (the syndrome weight is not
+ * updated) */
+void flip_column(decoder_t dec, index_t index, index_t position) {
+    if (dec->key) {
+#ifdef JIT
+        if (dec->key->jit) {
+            dec->key->jit->flip[index](dec->syndrome->vec + position,
+                                       dec->key->split[index][position]);
+            return;
+        }
+#endif
+        const index_t *columns = dec->key->H.columns[index];
+        const index_t *columns_wrap = dec->key->columns_wrap[index];
+        bit_t *syndrome = dec->syndrome->vec + position;
+        index_t split = dec->key->split[index][position];
+
+        for (index_t l = 0; l < split; ++l)
+            syndrome[columns[l]] ^= 1;
+        for (index_t l = split; l < BLOCK_WEIGHT; ++l)
+            syndrome[columns_wrap[l]] ^= 1;
+        return;
+    }
+
     index_t offset = position;
 
     index_t l;
@@ -76,24 +176,77 @@ static void single_flip(decoder_t dec, index_t index, index_t position) {
     bit_t counter = get_counter(dec, index, position);
     flip_column(dec, index, position);
     dec->bits[index][position] ^= 1;
+    ++dec->flips;
     dec->syndrome->weight += BLOCK_WEIGHT - 2 * counter;
     dec->e->weight +=
         2 * (dec->bits[index][position] ^ dec->e->vec[index][position]) - 1;
 }
 
+/* Record the state of the decoder at the end of an iteration, only called when
+ * it is traced. */
+static void trace_iteration(decoder_t dec, unsigned threshold, index_t black,
+                            index_t gray) {
+    struct trace_target *t = dec->trace;
+    long int flips = dec->flips - t->flips;
+    t->flips = dec->flips;
+    struct trace_record *r = capture_reserve_record(t->c, t->tid);
+    if (!r)
+        return;
+    r->index = t->index;
+    r->iter = dec->iter;
+    r->syndrome_weight = dec->syndrome->weight;
+    r->threshold = threshold;
+    r->flips = flips;
+    r->black = black;
+    r->gray = gray;
+    r->e_weight = dec->e->weight;
+#if (ALGO == BACKFLIP) || (ALGO == BACKFLIP2)
+    r->fl_length = dec->fl.length;
+#else
+    r->fl_length = 0;
+#endif
+    capture_commit(t->c, t->tid);
+}
+
+/* Bookkeeping at the end of each iteration */
+static inline void end_iteration(decoder_t dec, unsigned threshold,
+                                 index_t black, index_t gray) {
+    if (dec->syndrome->weight < dec->min_syndrome_weight) {
+        dec->min_syndrome_weight = dec->syndrome->weight;
+        dec->min_iter = dec->iter;
+    }
+    if (dec->trace)
+        trace_iteration(dec, threshold, black, gray);
+}
+
 void init_decoder(decoder_t dec, code_t *H, e_t *e, syndrome_t *syndrome) {
     dec->H = H;
+    dec->key = NULL;
+    dec->trace = NULL;
+    dec->histogram = NULL;
     dec->e = e;
     dec->syndrome = syndrome;
 }
 
+void init_decoder_key(decoder_t dec, key_data_t *key, e_t *e,
+                      syndrome_t *syndrome) {
+    init_decoder(dec, &key->H, e, syndrome);
+    dec->key = key;
+}
+
 void reset_decoder(decoder_t dec) {
     memset(dec->bits, 0, INDEX * BLOCK_LENGTH * sizeof(bit_t));
+    dec->flips = 0;
+    dec->min_syndrome_weight = BLOCK_LENGTH + 1;
+    dec->min_iter = 0;
 #if (ALGO == BACKFLIP) || (ALGO == BACKFLIP2)
     dec->fl.first = -1;
     dec->fl.length = 0;
 #endif
     dec->iter = 0;
+#if (ALGO == SBS) || (ALGO == SORT)
+    dec->sbs.started = false;
+#endif
 }
 
 #if (ALGO == CLASSIC)
@@ -103,11 +256,14 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
            !dec->blocked) {
         ++dec->iter;
 
-        compute_counters(dec->counters, dec->syndrome->vec, dec->H);
+        get_counters(dec);
 
+        PROFILE_BEGIN(PROFILE_THRESHOLD);
         unsigned threshold =
             compute_threshold(dec->syndrome->weight, dec->e->weight);
+        PROFILE_END(PROFILE_THRESHOLD);
 
+        PROFILE_BEGIN(PROFILE_FLIPS);
         dec->blocked = true;
         for (index_t k = 0; k < INDEX; ++k)
             for (index_t j = 0; j < BLOCK_LENGTH; ++j)
@@ -115,6 +271,8 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
                     single_flip(dec, k, j);
                     dec->blocked = false;
                 }
+        PROFILE_END(PROFILE_FLIPS);
+        end_iteration(dec, threshold, 0, 0);
     }
 
     return !dec->e->weight;
@@ -168,8 +326,9 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
     dec->blocked = false;
     while (dec->iter < max_iter && dec->syndrome->weight != SYNDROME_STOP) {
         ++dec->iter;
-        compute_counters(dec->counters, dec->syndrome->vec, dec->H);
+        get_counters(dec);
 
+        PROFILE_BEGIN(PROFILE_THRESHOLD);
         if (!dec->blocked) {
             int t = (ERROR_WEIGHT > dec->fl.length)
                         ? ERROR_WEIGHT - dec->fl.length
@@ -189,7 +348,9 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
                 compute_threshold_alpha(dec->syndrome->weight, t, THRESHOLD_A4);
 #endif
         }
+        PROFILE_END(PROFILE_THRESHOLD);
 
+        PROFILE_BEGIN(PROFILE_FLIPS);
         dec->blocked = true;
         for (index_t k = 0; k < INDEX; ++k) {
             for (index_t j = 0; j < BLOCK_LENGTH; ++j) {
@@ -240,6 +401,8 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
                 fl_pos = dec->fl.next[fl_pos];
             }
         }
+        PROFILE_END(PROFILE_FLIPS);
+        end_iteration(dec, threshold, 0, 0);
     }
 
     return !dec->e->weight;
@@ -255,11 +418,14 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
     while (dec->iter < max_iter && dec->syndrome->weight != SYNDROME_STOP &&
            !dec->blocked) {
         ++dec->iter;
-        compute_counters(dec->counters, dec->syndrome->vec, dec->H);
+        get_counters(dec);
 
+        PROFILE_BEGIN(PROFILE_THRESHOLD);
         if (!dec->blocked)
             threshold = compute_threshold_affine(dec->syndrome->weight);
+        PROFILE_END(PROFILE_THRESHOLD);
 
+        PROFILE_BEGIN(PROFILE_FLIPS);
         dec->blocked = true;
 
         dec->gray.length = 0;
@@ -324,62 +490,102 @@ int qcmdpc_decode(decoder_t dec, int max_iter) {
                 }
             }
         }
+        PROFILE_END(PROFILE_FLIPS);
+        end_iteration(dec, threshold, dec->black.length, dec->gray.length);
     }
 
     return !dec->e->weight;
 }
 #endif
 
+#if (ALGO == SBS) || (ALGO == SORT)
+/* Draw the next positions from generators seeded by 'prng', to continue a
+ * trajectory with fresh randomness. */
+void decoder_reseed(decoder_t dec, prng_t prng) {
+    prng_lanes_seed(&dec->sbs.lanes, prng);
+    dec->sbs.next_i = SBS_DRAWS;
+    dec->sbs.next_kl = SBS_DRAWS;
+}
+
+static void sbs_start(decoder_t dec, prng_t prng) {
+    struct sbs_state *st = &dec->sbs;
+    st->started = true;
+    st->stuck = false;
+    st->threshold = 0;
+    st->missed = 0;
+    /* Only recompute the threshold when necessary */
+    dec->blocked = false;
+    decoder_reseed(dec, prng);
+}
+#endif
+
 #if (ALGO == SBS)
+/* The decoding stops after 'max_iter' iterations, a later call continues it
+ * up to a larger number of iterations. */
 int qcmdpc_decode(decoder_t dec, int max_iter, prng_t prng) {
+    if (!dec->sbs.started)
+        sbs_start(dec, prng);
 #elif (ALGO == SORT)
 /* Step-by-step is used as the final step of the sorted gray decoder. */
-static int qcmdpc_decode_sbs(decoder_t dec, int max_iter, prng_t prng) {
+static int qcmdpc_decode_sbs(decoder_t dec, int max_iter) {
 #endif
 #if (ALGO == SBS) || (ALGO == SORT)
-    unsigned threshold = 0;
-    /* Only recompute the threshold when necessary */
-    dec->blocked = false;
-    unsigned long missed = 0;
-    while (dec->iter < max_iter && dec->syndrome->weight != SYNDROME_STOP) {
+    struct sbs_state *st = &dec->sbs;
+    while (!st->stuck && dec->iter < max_iter &&
+           dec->syndrome->weight != SYNDROME_STOP) {
         ++dec->iter;
-        if (missed > INDEX * BLOCK_LENGTH) {
-            compute_counters(dec->counters, dec->syndrome->vec, dec->H);
+        if (st->missed > INDEX * BLOCK_LENGTH) {
+            get_counters(dec);
             bool found = false;
             for (index_t k = 0; k < INDEX && !found; ++k) {
                 for (index_t j = 0; j < BLOCK_LENGTH && !found; ++j) {
-                    found |= (dec->counters[k][j] >= threshold);
+                    found |= (dec->counters[k][j] >= st->threshold);
                 }
             }
-            if (!found)
+            if (!found) {
+                st->stuck = true;
                 break;
-            missed = 0;
+            }
+            st->missed = 0;
         }
+        PROFILE_BEGIN(PROFILE_THRESHOLD);
         if (!dec->blocked)
-            threshold =
+            st->threshold =
                 compute_threshold(dec->syndrome->weight, dec->e->weight);
+        PROFILE_END(PROFILE_THRESHOLD);
 
+        PROFILE_BEGIN(PROFILE_FLIPS);
         dec->blocked = true;
         /* Randomly pick a 1 in the syndrome */
         int i;
         do {
-            i = prng->random_lim(BLOCK_LENGTH, prng->s);
+            if (st->next_i == SBS_DRAWS) {
+                prng_lanes_lim(&st->lanes, BLOCK_LENGTH, st->draw_i,
+                               SBS_DRAWS);
+                st->next_i = 0;
+            }
+            i = st->draw_i[st->next_i++];
         } while (!dec->syndrome->vec[i]);
-        int k;
-        k = prng->random_lim(INDEX, prng->s);
-        int l;
-        l = prng->random_lim(BLOCK_WEIGHT, prng->s);
+        if (st->next_kl == SBS_DRAWS) {
+            prng_lanes_lim(&st->lanes, INDEX, st->draw_k, SBS_DRAWS);
+            prng_lanes_lim(&st->lanes, BLOCK_WEIGHT, st->draw_l, SBS_DRAWS);
+            st->next_kl = 0;
+        }
+        int k = st->draw_k[st->next_kl];
+        int l = st->draw_l[st->next_kl++];
 
         int j = i + dec->H->rows[k][l];
         j = (j >= BLOCK_LENGTH) ? (j - BLOCK_LENGTH) : j;
 
         bit_t counter = get_counter(dec, k, j);
-        if (counter >= threshold) {
+        if (counter >= st->threshold) {
             single_flip(dec, k, j);
             dec->blocked = false;
         }
         else
-            ++missed;
+            ++st->missed;
+        PROFILE_END(PROFILE_FLIPS);
+        end_iteration(dec, st->threshold, 0, 0);
     }
 
     return !dec->e->weight;
@@ -458,13 +664,22 @@ static void sort_counters(pos_counter_t sorted_counters[GRAY_SIZE],
     qsort(sorted_counters, size, sizeof(pos_counter_t), cmp_pos_counter_t);
 }
 
+/* The decoding stops after 'max_iter' iterations, a later call continues it
+ * up to a larger number of iterations. */
 int qcmdpc_decode(decoder_t dec, int max_iter, prng_t prng) {
-    compute_counters(dec->counters, dec->syndrome->vec, dec->H);
-    sort_counters(dec->sorted_counters, dec->counters, GRAY_SIZE);
+    if (!dec->sbs.started) {
+        sbs_start(dec, prng);
+        get_counters(dec);
+        PROFILE_BEGIN(PROFILE_FLIPS);
+        sort_counters(dec->sorted_counters, dec->counters, GRAY_SIZE);
+        PROFILE_END(PROFILE_FLIPS);
+    }
 
     const unsigned threshold = (BLOCK_WEIGHT + 1) / 2;
 
-    index_t i = 0;
+    /* The sorted positions are visited in turn from the first iteration. */
+    PROFILE_BEGIN(PROFILE_FLIPS);
+    index_t i = dec->iter % GRAY_SIZE;
     while (dec->iter < INDEX * BLOCK_LENGTH && dec->iter < max_iter) {
         ++dec->iter;
         index_t k = dec->sorted_counters[i].index;
@@ -474,9 +689,11 @@ int qcmdpc_decode(decoder_t dec, int max_iter, prng_t prng) {
         if (counter >= threshold)
             single_flip(dec, k, j);
         i = (++i == GRAY_SIZE) ? 0 : i;
+        end_iteration(dec, threshold, 0, 0);
     }
+    PROFILE_END(PROFILE_FLIPS);
 
-    qcmdpc_decode_sbs(dec, max_iter, prng);
+    qcmdpc_decode_sbs(dec, max_iter);
 
     return !dec->e->weight;
 }
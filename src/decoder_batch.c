@@ -0,0 +1,396 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "param.h"
+#if BATCH
+#ifdef AVX
+#include <immintrin.h>
+#endif
+#include <string.h>
+
+#include "decoder_batch.h"
+#include "threshold.h"
+
+/* Number of consecutive positions whose counters are computed together. */
+#define BATCH_UNROLL 4
+
+/* Operations on all the lanes of a position at once. */
+#ifdef AVX
+typedef __m256i vlanes_t;
+
+static inline vlanes_t vl_zero(void) { return _mm256_setzero_si256(); }
+
+static inline vlanes_t vl_set1(bit_t x) { return _mm256_set1_epi8(x); }
+
+static inline vlanes_t vl_load(const bit_t *x) {
+    return _mm256_load_si256((const __m256i *)x);
+}
+
+static inline void vl_store(bit_t *x, vlanes_t v) {
+    _mm256_store_si256((__m256i *)x, v);
+}
+
+static inline vlanes_t vl_add(vlanes_t a, vlanes_t b) {
+    return _mm256_add_epi8(a, b);
+}
+
+static inline vlanes_t vl_adds(vlanes_t a, vlanes_t b) {
+    return _mm256_adds_epu8(a, b);
+}
+
+static inline void vl_xor_store(bit_t *x, vlanes_t v) {
+    vl_store(x, _mm256_xor_si256(vl_load(x), v));
+}
+
+/* Mask of the lanes where 'a' >= 'b'. */
+static inline lane_mask_t vl_ge(vlanes_t a, vlanes_t b) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a));
+}
+
+/* Byte set to 1 in the lanes of 'mask', 0 elsewhere. */
+static inline vlanes_t vl_expand(lane_mask_t mask) {
+    const __m256i shuffle =
+        _mm256_setr_epi64x(0x0000000000000000, 0x0101010101010101,
+                           0x0202020202020202, 0x0303030303030303);
+    const __m256i bit = _mm256_set1_epi64x(0x8040201008040201);
+
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(mask), shuffle);
+    v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit);
+    return _mm256_and_si256(v, _mm256_set1_epi8(1));
+}
+#else
+typedef struct {
+    bit_t b[BATCH_LANES];
+} vlanes_t;
+
+static inline vlanes_t vl_zero(void) { return (vlanes_t){{0}}; }
+
+static inline vlanes_t vl_set1(bit_t x) {
+    vlanes_t v;
+    for (index_t b = 0; b < BATCH_LANES; ++b)
+        v.b[b] = x;
+    return v;
+}
+
+static inline vlanes_t vl_load(const bit_t *x) {
+    vlanes_t v;
+    memcpy(v.b, x, BATCH_LANES * sizeof(bit_t));
+    return v;
+}
+
+static inline void vl_store(bit_t *x, vlanes_t v) {
+    memcpy(x, v.b, BATCH_LANES * sizeof(bit_t));
+}
+
+static inline vlanes_t vl_add(vlanes_t a, vlanes_t b) {
+    for (index_t i = 0; i < BATCH_LANES; ++i)
+        a.b[i] += b.b[i];
+    return a;
+}
+
+static inline vlanes_t vl_adds(vlanes_t a, vlanes_t b) {
+    for (index_t i = 0; i < BATCH_LANES; ++i)
+        a.b[i] = (a.b[i] + b.b[i] > 255) ? 255 : a.b[i] + b.b[i];
+    return a;
+}
+
+static inline void vl_xor_store(bit_t *x, vlanes_t v) {
+    for (index_t i = 0; i < BATCH_LANES; ++i)
+        x[i] ^= v.b[i];
+}
+
+/* Mask of the lanes where 'a' >= 'b'. */
+static inline lane_mask_t vl_ge(vlanes_t a, vlanes_t b) {
+    lane_mask_t mask = 0;
+    for (index_t i = 0; i < BATCH_LANES; ++i)
+        mask |= (lane_mask_t)(a.b[i] >= b.b[i]) << i;
+    return mask;
+}
+
+/* Byte set to 1 in the lanes of 'mask', 0 elsewhere. */
+static inline vlanes_t vl_expand(lane_mask_t mask) {
+    vlanes_t v;
+    for (index_t i = 0; i < BATCH_LANES; ++i)
+        v.b[i] = (mask >> i) & 1;
+    return v;
+}
+#endif
+
+static void mirror_syndrome(decoder_batch_t dec);
+static void update_syndrome_weight(decoder_batch_t dec);
+static vlanes_t get_counter(decoder_batch_t dec, index_t index,
+                            index_t position);
+static void get_counters(decoder_batch_t dec, index_t index, index_t position,
+                         vlanes_t counters[BATCH_UNROLL]);
+static void flip_column(decoder_batch_t dec, index_t index, index_t position,
+                        lane_mask_t mask);
+static void lanes_flip(decoder_batch_t dec, index_t position, lane_mask_t mask);
+static lane_mask_t lanes_step(decoder_batch_t dec, struct lane_array *a);
+
+static void mirror_syndrome(decoder_batch_t dec) {
+    memcpy(dec->syndrome + BLOCK_LENGTH, dec->syndrome,
+           BLOCK_LENGTH * sizeof(lanes_t));
+}
+
+static void update_syndrome_weight(decoder_batch_t dec) {
+    memset(dec->syndrome_weight, 0, BATCH_LANES * sizeof(index_t));
+    /* Sum by chunks small enough for the byte accumulators not to overflow. */
+    for (index_t j0 = 0; j0 < BLOCK_LENGTH; j0 += 255) {
+        index_t end = (j0 + 255 < BLOCK_LENGTH) ? j0 + 255 : BLOCK_LENGTH;
+        vlanes_t acc = vl_zero();
+        for (index_t j = j0; j < end; ++j)
+            acc = vl_add(acc, vl_load(dec->syndrome[j]));
+
+        lanes_t weight;
+        vl_store(weight, acc);
+        for (index_t b = 0; b < BATCH_LANES; ++b)
+            dec->syndrome_weight[b] += weight[b];
+    }
+}
+
+/* The syndrome has to be mirrored before computing counters. */
+static vlanes_t get_counter(decoder_batch_t dec, index_t index,
+                            index_t position) {
+    const index_t *columns = dec->H->columns[index];
+    const lanes_t *syndrome = dec->syndrome + position;
+
+    /* Two accumulators to shorten the dependency chain. */
+    vlanes_t counter0 = vl_zero();
+    vlanes_t counter1 = vl_zero();
+    index_t l;
+    for (l = 0; l + 1 < BLOCK_WEIGHT; l += 2) {
+        counter0 = vl_add(counter0, vl_load(syndrome[columns[l]]));
+        counter1 = vl_add(counter1, vl_load(syndrome[columns[l + 1]]));
+    }
+    if (l < BLOCK_WEIGHT)
+        counter0 = vl_add(counter0, vl_load(syndrome[columns[l]]));
+
+    return vl_add(counter0, counter1);
+}
+
+/* Counters of BATCH_UNROLL consecutive positions. */
+static void get_counters(decoder_batch_t dec, index_t index, index_t position,
+                         vlanes_t counters[BATCH_UNROLL]) {
+    const index_t *columns = dec->H->columns[index];
+    const lanes_t *syndrome = dec->syndrome + position;
+
+    for (index_t u = 0; u < BATCH_UNROLL; ++u)
+        counters[u] = vl_zero();
+    for (index_t l = 0; l < BLOCK_WEIGHT; ++l) {
+        const lanes_t *s = syndrome + columns[l];
+        for (index_t u = 0; u < BATCH_UNROLL; ++u)
+            counters[u] = vl_add(counters[u], vl_load(s[u]));
+    }
+}
+
+/* Only the first half of the syndrome is updated. */
+static void flip_column(decoder_batch_t dec, index_t index, index_t position,
+                        lane_mask_t mask) {
+    const index_t *columns = dec->H->columns[index];
+    vlanes_t v = vl_expand(mask);
+
+    index_t l;
+    for (l = 0; l < BLOCK_WEIGHT; ++l) {
+        index_t i = position + columns[l];
+        if (i >= BLOCK_LENGTH)
+            break;
+        vl_xor_store(dec->syndrome[i], v);
+    }
+    for (; l < BLOCK_WEIGHT; ++l) {
+        index_t i = position + columns[l] - BLOCK_LENGTH;
+        vl_xor_store(dec->syndrome[i], v);
+    }
+}
+
+static void lanes_flip(decoder_batch_t dec, index_t position,
+                       lane_mask_t mask) {
+    index_t k = position / BLOCK_LENGTH;
+    index_t j = position - k * BLOCK_LENGTH;
+
+    flip_column(dec, k, j, mask);
+    dec->bits[k][j] ^= mask;
+}
+
+/* Black or gray step: recompute the counters of the positions in 'a' and flip
+ * them in the lanes where they are above the majority.
+ * Return the lanes in which a flip occurred. */
+static lane_mask_t lanes_step(decoder_batch_t dec, struct lane_array *a) {
+    const vlanes_t threshold = vl_set1((BLOCK_WEIGHT + 1) / 2 + 1);
+
+    mirror_syndrome(dec);
+    for (index_t i = 0; i < a->length; ++i) {
+        index_t k = a->position[i] / BLOCK_LENGTH;
+        index_t j = a->position[i] - k * BLOCK_LENGTH;
+        a->mask[i] &= vl_ge(get_counter(dec, k, j), threshold);
+    }
+
+    lane_mask_t flipped = 0;
+    for (index_t i = 0; i < a->length; ++i) {
+        if (a->mask[i]) {
+            lanes_flip(dec, a->position[i], a->mask[i]);
+            flipped |= a->mask[i];
+        }
+    }
+
+    return flipped;
+}
+
+void init_decoder_batch(decoder_batch_t dec, code_t *H) { dec->H = H; }
+
+void reset_decoder_batch(decoder_batch_t dec) {
+    memset(dec->syndrome, 0, BLOCK_LENGTH * sizeof(lanes_t));
+    memset(dec->bits, 0, INDEX * BLOCK_LENGTH * sizeof(lane_mask_t));
+    memset(dec->iter, 0, BATCH_LANES * sizeof(index_t));
+    dec->active = 0;
+}
+
+/* Add the syndrome of an error of weight ERROR_WEIGHT in lane 'lane'. */
+void batch_add_error(decoder_batch_t dec, index_t lane,
+                     const sparse_t e_sparse) {
+    memcpy(dec->error[lane], e_sparse, ERROR_WEIGHT * sizeof(index_t));
+    for (index_t l = 0; l < ERROR_WEIGHT; ++l) {
+        index_t k = e_sparse[l] / BLOCK_LENGTH;
+        flip_column(dec, k, e_sparse[l] - k * BLOCK_LENGTH,
+                    (lane_mask_t)1 << lane);
+    }
+    dec->active |= (lane_mask_t)1 << lane;
+}
+
+void batch_add_syndrome_error(decoder_batch_t dec, index_t lane,
+                              const sparse_t e_sparse, index_t weight) {
+    for (index_t l = 0; l < weight; ++l) {
+        dec->syndrome[e_sparse[l]][lane] ^= 1;
+    }
+}
+
+/* Decode all the active lanes, dec->iter holds the number of iterations of
+ * each lane.
+ * Return the lanes that were successfully decoded. */
+lane_mask_t qcmdpc_decode_batch(decoder_batch_t dec, int max_iter) {
+    const vlanes_t delta = vl_set1(GRAY_DELTA);
+    index_t iter = 0;
+    lane_mask_t unblocked = dec->active;
+
+    update_syndrome_weight(dec);
+    while (1) {
+        /* Retire the lanes that the single instance decoder would stop. */
+        lane_mask_t done = ~unblocked;
+        for (index_t b = 0; b < BATCH_LANES; ++b)
+            if (iter >= max_iter || dec->syndrome_weight[b] == SYNDROME_STOP)
+                done |= (lane_mask_t)1 << b;
+        for (index_t b = 0; b < BATCH_LANES; ++b)
+            if ((dec->active & done) >> b & 1)
+                dec->iter[b] = iter;
+        dec->active &= ~done;
+        if (!dec->active)
+            break;
+
+        ++iter;
+
+        /* Thresholds of each lane */
+        lanes_t thresholds;
+        for (index_t b = 0; b < BATCH_LANES; ++b) {
+            unsigned thr = compute_threshold_affine(dec->syndrome_weight[b]);
+            thresholds[b] = (thr < 255) ? thr : 255;
+        }
+        const vlanes_t threshold = vl_load(thresholds);
+
+        mirror_syndrome(dec);
+        dec->gray.length = 0;
+        dec->black.length = 0;
+        for (index_t k = 0; k < INDEX; ++k) {
+            for (index_t j = 0; j < BLOCK_LENGTH; j += BATCH_UNROLL) {
+                vlanes_t counters[BATCH_UNROLL];
+                index_t n = BATCH_UNROLL;
+                if (j + BATCH_UNROLL <= BLOCK_LENGTH) {
+                    get_counters(dec, k, j, counters);
+                }
+                else {
+                    n = BLOCK_LENGTH - j;
+                    for (index_t u = 0; u < n; ++u)
+                        counters[u] = get_counter(dec, k, j + u);
+                }
+                for (index_t u = 0; u < n; ++u) {
+                    lane_mask_t black =
+                        vl_ge(counters[u], threshold) & dec->active;
+                    lane_mask_t gray =
+                        vl_ge(vl_adds(counters[u], delta), threshold) &
+                        dec->active & ~black;
+                    if (black) {
+                        index_t curr = dec->black.length++;
+                        dec->black.position[curr] = k * BLOCK_LENGTH + j + u;
+                        dec->black.mask[curr] = black;
+                    }
+                    if (gray) {
+                        index_t curr = dec->gray.length++;
+                        dec->gray.position[curr] = k * BLOCK_LENGTH + j + u;
+                        dec->gray.mask[curr] = gray;
+                    }
+                }
+            }
+        }
+        unblocked = 0;
+        for (index_t i = 0; i < dec->black.length; ++i) {
+            lanes_flip(dec, dec->black.position[i], dec->black.mask[i]);
+            unblocked |= dec->black.mask[i];
+        }
+/* We count each black or gray step as an iteration. */
+#if (ALGO == GRAY_BGF)
+        if (iter < 2)
+#endif
+        {
+            ++iter;
+            unblocked |= lanes_step(dec, &dec->black);
+#if (ALGO == GRAY_BGB)
+            if (iter < 3)
+#elif (ALGO == GRAY_B)
+            if (0)
+#endif
+            {
+                ++iter;
+                unblocked |= lanes_step(dec, &dec->gray);
+            }
+        }
+
+        update_syndrome_weight(dec);
+    }
+
+    /* A lane is decoded when its flipped bits are exactly its error. */
+    index_t weight[BATCH_LANES] = {0};
+    for (index_t k = 0; k < INDEX; ++k)
+        for (index_t j = 0; j < BLOCK_LENGTH; ++j)
+            for (lane_mask_t m = dec->bits[k][j]; m; m &= m - 1)
+                ++weight[__builtin_ctz(m)];
+
+    lane_mask_t success = 0;
+    for (index_t b = 0; b < BATCH_LANES; ++b) {
+        int decoded = (weight[b] == ERROR_WEIGHT);
+        for (index_t l = 0; l < ERROR_WEIGHT && decoded; ++l) {
+            index_t k = dec->error[b][l] / BLOCK_LENGTH;
+            index_t j = dec->error[b][l] - k * BLOCK_LENGTH;
+            decoded = (dec->bits[k][j] >> b) & 1;
+        }
+        success |= (lane_mask_t)decoded << b;
+    }
+
+    return success;
+}
+#endif
@@ -27,6 +27,7 @@
 
 #include "code.h"
 #include "decoder_bp.h"
+#include "profile.h"
 #include "sparse_cyclic.h"
 #include "threshold.h"
 
@@ -132,8 +133,11 @@ int qcmdpc_decode(decoder_bp_t dec, int max_iter) {
         dec->tree + (1L << LOG2(INDEX * BLOCK_WEIGHT)));
 
     dec->iter = 0;
+    dec->min_syndrome_weight = BLOCK_LENGTH + 1;
+    dec->min_iter = 0;
     while (dec->iter < max_iter) {
         ++dec->iter;
+        PROFILE_BEGIN(PROFILE_BP);
         for (index_t i = 0; i < BLOCK_LENGTH; ++i) {
             for (index_t k = 0; k < INDEX; ++k)
                 for (index_t l = 0; l < BLOCK_WEIGHT; ++l) {
@@ -163,8 +167,15 @@ int qcmdpc_decode(decoder_bp_t dec, int max_iter) {
                         SATURATE(dec->r[k][j] + messages_v[l], BP_SATURATE);
                 }
             }
+        PROFILE_END(PROFILE_BP);
+        PROFILE_BEGIN(PROFILE_SYNDROME);
         to_binary(dec);
         compute_syndrome(dec->syndrome, dec->H, &dec->bits);
+        PROFILE_END(PROFILE_SYNDROME);
+        if (dec->syndrome->weight < dec->min_syndrome_weight) {
+            dec->min_syndrome_weight = dec->syndrome->weight;
+            dec->min_iter = dec->iter;
+        }
         if (dec->syndrome->weight == SYNDROME_STOP)
             break;
     }
@@ -19,6 +19,8 @@
    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
    IN THE SOFTWARE
 */
+#include <math.h>
+
 #include "errorgen.h"
 #include "param.h"
 #include "sparse_cyclic.h"
@@ -32,46 +34,52 @@ void generate_random_syndrome_error(sparse_t e_block, index_t weight,
     sparse_rand(e_block, weight, BLOCK_LENGTH, prng);
 }
 
+/* Position 'i' of a word shifted by 'shift' in each block */
+static inline index_t shift_position(index_t i, index_t shift) {
+    index_t k = i >= BLOCK_LENGTH;
+    return k ? (i - BLOCK_LENGTH + shift) % BLOCK_LENGTH + BLOCK_LENGTH
+             : (i + shift) % BLOCK_LENGTH;
+}
+
 /* Generate an error pattern with a fixed number intersections and specific
  * total weight. */
 void generate_around_word(sparse_t e_dst, index_t weight_dst, sparse_t e_src,
                           index_t weight_src, index_t intersections,
                           prng_t prng) {
-    bit_t e[INDEX * BLOCK_LENGTH] = {0};
-    bit_t h[INDEX * BLOCK_LENGTH] = {0};
+    /* Positions in the error pattern and in the word, only the entries
+     * touched by this call are nonzero and they are reset before returning. */
+    enum { IN_ERROR = 1, IN_WORD = 2 };
+    static _Thread_local uint8_t marks[INDEX * BLOCK_LENGTH];
 
     /* Pick a near-codeword. */
-    index_t shift = prng->random_lim(BLOCK_LENGTH, prng->s);
-    for (index_t l = 0; l < weight_src; ++l) {
-        index_t k = e_src[l] >= BLOCK_LENGTH;
-        index_t i =
-            k ? (e_src[l] - BLOCK_LENGTH + shift) % BLOCK_LENGTH + BLOCK_LENGTH
-              : (e_src[l] + shift) % BLOCK_LENGTH;
-        h[i] = 1;
-    }
+    index_t shift = random_lim(BLOCK_LENGTH, prng->s);
+    for (index_t l = 0; l < weight_src; ++l)
+        marks[shift_position(e_src[l], shift)] = IN_WORD;
 
     /* Pick `intersections` common positions with the near-codeword. */
     index_t error_weight = 0;
     while (error_weight < intersections) {
-        index_t lrand = prng->random_lim(weight_src, prng->s);
-        index_t k = e_src[lrand] >= BLOCK_LENGTH;
-        index_t i = k ? (e_src[lrand] - BLOCK_LENGTH + shift) % BLOCK_LENGTH +
-                            BLOCK_LENGTH
-                      : (e_src[lrand] + shift) % BLOCK_LENGTH;
-        if (!e[i]) {
-            e[i] = 1;
+        index_t lrand = random_lim(weight_src, prng->s);
+        index_t i = shift_position(e_src[lrand], shift);
+        if (!(marks[i] & IN_ERROR)) {
+            marks[i] |= IN_ERROR;
             insert_sorted_noinc(e_dst, i, error_weight++);
         }
     }
 
     /* Complete the error pattern. */
     while (error_weight < weight_dst) {
-        index_t jrand = prng->random_lim(INDEX * BLOCK_LENGTH, prng->s);
-        if (!e[jrand] && !h[jrand]) {
-            e[jrand] = 1;
+        index_t jrand = random_lim(INDEX * BLOCK_LENGTH, prng->s);
+        if (!marks[jrand]) {
+            marks[jrand] = IN_ERROR;
             insert_sorted_noinc(e_dst, jrand, error_weight++);
         }
     }
+
+    for (index_t l = 0; l < weight_src; ++l)
+        marks[shift_position(e_src[l], shift)] = 0;
+    for (index_t l = 0; l < weight_dst; ++l)
+        marks[e_dst[l]] = 0;
 }
 
 /* Generate an error pattern with ERROR_FLOOR_P intersection with a
@@ -80,7 +88,7 @@ void generate_near_codeword(sparse_t e_block, code_t *H, prng_t prng) {
     index_t e_src[BLOCK_WEIGHT];
 
     /* Pick a near-codeword. */
-    index_t k = prng->random_lim(INDEX, prng->s);
+    index_t k = random_lim(INDEX, prng->s);
 
     for (index_t l = 0; l < BLOCK_WEIGHT; ++l) {
         e_src[l] = k * BLOCK_LENGTH + H->columns[k][l];
@@ -100,7 +108,7 @@ void generate_near_codeword2(sparse_t e_block, code_t *H, prng_t prng) {
     }
 
     /* Pick a near-codeword. */
-    index_t shift = prng->random_lim(BLOCK_LENGTH, prng->s);
+    index_t shift = random_lim(BLOCK_LENGTH, prng->s);
     for (index_t l = 0; l < BLOCK_WEIGHT; ++l) {
         index_t i = H->columns[1][l] + shift;
         i = (i <= BLOCK_LENGTH) ? i : (i - BLOCK_LENGTH);
@@ -133,3 +141,89 @@ void generate_codeword(sparse_t e_block, code_t *H, prng_t prng) {
     generate_around_word(e_block, ERROR_WEIGHT, e_src, 2 * BLOCK_WEIGHT,
                          ERROR_FLOOR_P, prng);
 }
+
+static double lnbino(double n, double k) {
+    return lgamma(n + 1) - lgamma(k + 1) - lgamma(n - k + 1);
+}
+
+void init_tilt(tilt_t *tilt, double theta) {
+    /* Log of the hypergeometric distribution, tilted and not normalized */
+    double log_q[TILT_MAX + 1];
+    double max = -INFINITY;
+    for (index_t l = 0; l <= TILT_MAX; ++l) {
+        log_q[l] = lnbino(BLOCK_WEIGHT, l) +
+                   lnbino(INDEX * BLOCK_LENGTH - BLOCK_WEIGHT,
+                          ERROR_WEIGHT - l) -
+                   lnbino(INDEX * BLOCK_LENGTH, ERROR_WEIGHT) + theta * l;
+        max = (log_q[l] > max) ? log_q[l] : max;
+    }
+    double sum = 0;
+    for (index_t l = 0; l <= TILT_MAX; ++l)
+        sum += exp(log_q[l] - max);
+
+    tilt->theta = theta;
+    tilt->log_z = max + log(sum);
+    double cdf = 0;
+    for (index_t l = 0; l <= TILT_MAX; ++l) {
+        tilt->ratio[l] = exp(theta * l - tilt->log_z);
+        cdf += exp(log_q[l] - tilt->log_z);
+        tilt->cdf[l] = cdf;
+    }
+    tilt->cdf[TILT_MAX] = 1.;
+}
+
+/* Generate an error pattern around a random column of 'H' (any block, any
+ * shift) with a tilted number of intersections. Returns the likelihood ratio
+ * of the error pattern, i.e. the probability of the pattern with
+ * generate_random_error divided by its probability with this function.
+ *
+ * The probability of the pattern with this function is the average over all
+ * the columns of ratio[l] / C(n, t), with l the intersection with the column,
+ * so the likelihood ratio does not depend on the column actually picked. */
+double generate_tilted_error(sparse_t e_block, code_t *H, const tilt_t *tilt,
+                             prng_t prng) {
+    /* Intersections with all the columns, only the entries touched by the
+     * error pattern are nonzero and they are reset before returning. */
+    static _Thread_local uint8_t intersections[INDEX][BLOCK_LENGTH];
+    index_t e_src[BLOCK_WEIGHT];
+
+    double u = (random_uint64_t(prng->s) >> 11) * 0x1.0p-53;
+    index_t l;
+    for (l = 0; l < TILT_MAX && tilt->cdf[l] <= u; ++l)
+        ;
+
+    index_t k = random_lim(INDEX, prng->s);
+    for (index_t m = 0; m < BLOCK_WEIGHT; ++m)
+        e_src[m] = k * BLOCK_LENGTH + H->columns[k][m];
+    generate_around_word(e_block, ERROR_WEIGHT, e_src, BLOCK_WEIGHT, l, prng);
+
+    /* Number of columns intersecting the error pattern on 'l' positions */
+    long int count[TILT_MAX + 1] = {INDEX * BLOCK_LENGTH};
+    for (index_t i = 0; i < ERROR_WEIGHT; ++i) {
+        index_t b = e_block[i] / BLOCK_LENGTH;
+        index_t j = e_block[i] % BLOCK_LENGTH;
+        for (index_t m = 0; m < BLOCK_WEIGHT; ++m) {
+            index_t shift = j - H->columns[b][m];
+            shift += (shift < 0) ? BLOCK_LENGTH : 0;
+            uint8_t *x = &intersections[b][shift];
+            --count[*x];
+            ++count[++*x];
+        }
+    }
+    for (index_t i = 0; i < ERROR_WEIGHT; ++i) {
+        index_t b = e_block[i] / BLOCK_LENGTH;
+        index_t j = e_block[i] % BLOCK_LENGTH;
+        for (index_t m = 0; m < BLOCK_WEIGHT; ++m) {
+            index_t shift = j - H->columns[b][m];
+            shift += (shift < 0) ? BLOCK_LENGTH : 0;
+            intersections[b][shift] = 0;
+        }
+    }
+
+    double mean = 0;
+    for (index_t m = 0; m <= TILT_MAX; ++m)
+        mean += count[m] * tilt->ratio[m];
+    mean /= INDEX * BLOCK_LENGTH;
+
+    return 1. / mean;
+}
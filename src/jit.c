@@ -0,0 +1,271 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "param.h"
+#ifdef JIT
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "jit.h"
+
+/* Number of 256-bit accumulators of the counters kernel. */
+#define JIT_BUFF_LEN 8
+/* Upper bound on the size of the kernels of one block. */
+#define JIT_BLOCK_SIZE (90 * BLOCK_WEIGHT + 512)
+/* Alignment of the kernels. */
+#define JIT_ALIGN 32
+
+static void emit8(uint8_t **p, uint8_t x) { *(*p)++ = x; }
+
+static void emit32(uint8_t **p, int32_t x) {
+    memcpy(*p, &x, sizeof(x));
+    *p += sizeof(x);
+}
+
+/* Set a rel32 field to point to the current position. */
+static void patch_rel32(uint8_t *rel, uint8_t *p) {
+    int32_t x = p - (rel + sizeof(x));
+    memcpy(rel, &x, sizeof(x));
+}
+
+static uint8_t *align(uint8_t *p) {
+    /* int3 */
+    while ((uintptr_t)p % JIT_ALIGN)
+        emit8(&p, 0xcc);
+    return p;
+}
+
+/* Register number of the base of a memory operand. */
+#define RSI 6
+#define RDI 7
+
+static void emit_entry(uint8_t **p, bool flip, uint8_t base, index_t offset) {
+    if (flip) {
+        /* xor byte [base + offset], 1 */
+        emit8(p, 0x80);
+        emit8(p, 0xb0 | base);
+        emit32(p, offset);
+        emit8(p, 0x01);
+    }
+    else {
+        /* add al, [base + offset] */
+        emit8(p, 0x02);
+        emit8(p, 0x80 | base);
+        emit32(p, offset);
+    }
+}
+
+/* Kernel for a single column, called as f(syndrome + position, split).
+ *
+ * Offsets that wrap around are read relative to syndrome + position - r. The
+ * code is laid out as the entries for all offsets relative to this wrapped
+ * base, followed by the entries for all offsets relative to the unwrapped base
+ * in reverse order. Only the entries l >= split are executed in the first run
+ * and the entries l < split in the second one, both entry points are computed
+ * from 'split'. */
+static uint8_t *emit_column(uint8_t *p, const index_t *columns, bool flip) {
+    const uint8_t entry_size = flip ? 7 : 6;
+
+    if (!flip) {
+        /* xor eax, eax */
+        emit8(&p, 0x31);
+        emit8(&p, 0xc0);
+    }
+    /* lea rcx, [rip + wrapped] */
+    emit8(&p, 0x48);
+    emit8(&p, 0x8d);
+    emit8(&p, 0x0d);
+    uint8_t *wrapped_rel = p;
+    emit32(&p, 0);
+    /* imul rdx, rsi, entry_size */
+    emit8(&p, 0x48);
+    emit8(&p, 0x6b);
+    emit8(&p, 0xd6);
+    emit8(&p, entry_size);
+    /* lea r9, [rip + end] */
+    emit8(&p, 0x4c);
+    emit8(&p, 0x8d);
+    emit8(&p, 0x0d);
+    uint8_t *end_rel = p;
+    emit32(&p, 0);
+    /* sub r9, rdx */
+    emit8(&p, 0x49);
+    emit8(&p, 0x29);
+    emit8(&p, 0xd1);
+    /* add rcx, rdx */
+    emit8(&p, 0x48);
+    emit8(&p, 0x01);
+    emit8(&p, 0xd1);
+    /* lea rsi, [rdi - r] */
+    emit8(&p, 0x48);
+    emit8(&p, 0x8d);
+    emit8(&p, 0xb7);
+    emit32(&p, -BLOCK_LENGTH);
+    /* jmp rcx */
+    emit8(&p, 0xff);
+    emit8(&p, 0xe1);
+
+    patch_rel32(wrapped_rel, p);
+    for (index_t l = 0; l < BLOCK_WEIGHT; ++l)
+        emit_entry(&p, flip, RSI, columns[l]);
+    /* jmp r9 */
+    emit8(&p, 0x41);
+    emit8(&p, 0xff);
+    emit8(&p, 0xe1);
+    for (index_t l = BLOCK_WEIGHT - 1; l >= 0; --l)
+        emit_entry(&p, flip, RDI, columns[l]);
+    patch_rel32(end_rel, p);
+    /* ret */
+    emit8(&p, 0xc3);
+
+    return p;
+}
+
+#ifdef AVX
+/* Second byte of a two-byte VEX prefix for a 256-bit operation with the 66
+ * prefix, 'k' being the first source register. */
+static uint8_t vex_66(uint8_t k) { return 0x80 | ((~k & 0xf) << 3) | 0x05; }
+
+/* Same as multiply_avx2 for a given sparse vector, called as
+ * f(counters, syndrome). */
+static uint8_t *emit_counters(uint8_t *p, const index_t *columns) {
+    /* mov edx, number of iterations */
+    emit8(&p, 0xba);
+    emit32(&p, SIZE_AVX / (32 * JIT_BUFF_LEN));
+
+    uint8_t *loop = p;
+    for (uint8_t k = 0; k < JIT_BUFF_LEN; ++k) {
+        /* vpxor ymmk, ymmk, ymmk */
+        emit8(&p, 0xc5);
+        emit8(&p, vex_66(k));
+        emit8(&p, 0xef);
+        emit8(&p, 0xc0 | (k << 3) | k);
+    }
+    for (index_t l = 0; l < BLOCK_WEIGHT; ++l) {
+        for (uint8_t k = 0; k < JIT_BUFF_LEN; ++k) {
+            /* vpaddb ymmk, ymmk, [rsi + offset + 32 * k] */
+            emit8(&p, 0xc5);
+            emit8(&p, vex_66(k));
+            emit8(&p, 0xfc);
+            emit8(&p, 0x80 | (k << 3) | RSI);
+            emit32(&p, columns[l] + 32 * k);
+        }
+    }
+    for (uint8_t k = 0; k < JIT_BUFF_LEN; ++k) {
+        /* vmovdqu [rdi + 32 * k], ymmk */
+        emit8(&p, 0xc5);
+        emit8(&p, 0xfe);
+        emit8(&p, 0x7f);
+        emit8(&p, 0x80 | (k << 3) | RDI);
+        emit32(&p, 32 * k);
+    }
+    /* add rdi, 32 * JIT_BUFF_LEN */
+    emit8(&p, 0x48);
+    emit8(&p, 0x81);
+    emit8(&p, 0xc7);
+    emit32(&p, 32 * JIT_BUFF_LEN);
+    /* add rsi, 32 * JIT_BUFF_LEN */
+    emit8(&p, 0x48);
+    emit8(&p, 0x81);
+    emit8(&p, 0xc6);
+    emit32(&p, 32 * JIT_BUFF_LEN);
+    /* dec edx */
+    emit8(&p, 0xff);
+    emit8(&p, 0xca);
+    /* jnz loop */
+    emit8(&p, 0x0f);
+    emit8(&p, 0x85);
+    emit32(&p, loop - (p + 4));
+    /* vzeroupper */
+    emit8(&p, 0xc5);
+    emit8(&p, 0xf8);
+    emit8(&p, 0x77);
+    /* ret */
+    emit8(&p, 0xc3);
+
+    return p;
+}
+#endif
+
+/* Returns NULL if no executable memory can be mapped, the caller should then
+ * use the generic code. */
+struct jit *jit_alloc(void) {
+    struct jit *jit = calloc(1, sizeof(struct jit));
+    if (!jit)
+        return NULL;
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    jit->size = (INDEX * JIT_BLOCK_SIZE + page - 1) / page * page;
+    jit->code = mmap(NULL, jit->size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED ||
+        mprotect(jit->code, jit->size, PROT_READ | PROT_EXEC)) {
+        if (jit->code != MAP_FAILED)
+            munmap(jit->code, jit->size);
+        free(jit);
+        return NULL;
+    }
+    return jit;
+}
+
+void jit_free(struct jit *jit) {
+    if (!jit)
+        return;
+    munmap(jit->code, jit->size);
+    free(jit);
+}
+
+/* Generate the kernels for the parity check matrix 'H', must not be called
+ * while the previous kernels are in use. Returns 0 on success. */
+int jit_compile(struct jit *jit, const code_t *H) {
+    if (mprotect(jit->code, jit->size, PROT_READ | PROT_WRITE))
+        return -1;
+
+    uint8_t *p = jit->code;
+    for (index_t k = 0; k < INDEX; ++k) {
+#ifdef AVX
+        jit->counters[k] = (jit_counters_t)p;
+        p = align(emit_counters(p, H->columns[k]));
+#else
+        jit->counters[k] = NULL;
+#endif
+        jit->counter[k] = (jit_counter_t)p;
+        p = align(emit_column(p, H->columns[k], false));
+        jit->flip[k] = (jit_flip_t)p;
+        p = align(emit_column(p, H->columns[k], true));
+    }
+    __builtin___clear_cache((char *)jit->code, (char *)p);
+
+    return mprotect(jit->code, jit->size, PROT_READ | PROT_EXEC);
+}
+
+#ifdef AVX
+void jit_compute_counters(const struct jit *jit, counters_t counters,
+                          bit_t *syndrome) {
+    memcpy(syndrome + BLOCK_LENGTH, syndrome, BLOCK_LENGTH * sizeof(bit_t));
+    for (index_t i = 0; i < INDEX; ++i)
+        jit->counters[i](counters[i], syndrome);
+}
+#endif
+#endif
@@ -0,0 +1,119 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+/* Display the statistics pages published by simulations (option -P) in the
+ * format of their output, so that the scripts can read them. */
+
+static void print_usage(char *arg0) {
+    fprintf(stderr,
+            "usage: %s [OPTIONS] FILE...\n"
+            "\n"
+            "Print the results published in the statistics files FILE by "
+            "running\n"
+            "simulations.\n"
+            "\n"
+            "-w, --watch SEC  print them again every SEC seconds\n",
+            arg0);
+    exit(2);
+}
+
+/* Returns 0 on success. */
+static int print_page(const char *filename) {
+    struct stats_page *p = stats_read(filename);
+    if (!p) {
+        fprintf(stderr, "Could not read statistics file '%s'\n", filename);
+        return 1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    const int64_t *test = stats_thread_test(p);
+    const double *rate = stats_thread_rate(p);
+    double total = 0;
+    for (int i = 0; i < p->n_threads; ++i)
+        total += rate[i];
+
+    /* Age of the last update, a simulation killed before its end stops
+     * updating its page while still appearing as running */
+    printf("# stats=%s pid=%d running=%d elapsed=%.1f age=%.1f rate=%.1f",
+           filename, p->pid, p->running, p->elapsed,
+           now.tv_sec + now.tv_nsec * 1e-9 - p->updated, total);
+    printf(" threads=");
+    for (int i = 0; i < p->n_threads; ++i)
+        printf("%s%" PRId64 ":%.1f", i ? "," : "", test[i], rate[i]);
+    printf("\n%s\n", p->params);
+    printf("# seed=%" PRIu64 "\n", p->seed);
+
+    const int64_t *n_iter = stats_n_iter(p);
+    printf("%" PRId64, p->n_test);
+    for (int it = 0; it <= p->max_iter; ++it) {
+        if (n_iter[it])
+            printf(" %d:%" PRId64, it, n_iter[it]);
+    }
+    if (p->n_success != p->n_test)
+        printf(" >%d:%" PRId64, p->max_iter, p->n_test - p->n_success);
+    printf("\n");
+
+    free(p);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int watch = 0;
+
+    const char *options = "w:";
+    static struct option longopts[] = {{"watch", required_argument, 0, 'w'},
+                                       {NULL, 0, 0, 0}};
+    int ch;
+    while ((ch = getopt_long(argc, argv, options, longopts, NULL)) != -1) {
+        switch (ch) {
+        case 'w':
+            watch = atoi(optarg);
+            if (watch < 1)
+                print_usage(argv[0]);
+            break;
+        default:
+            print_usage(argv[0]);
+            break;
+        }
+    }
+    if (optind == argc)
+        print_usage(argv[0]);
+
+    int ret;
+    do {
+        ret = EXIT_SUCCESS;
+        for (int i = optind; i < argc; ++i)
+            if (print_page(argv[i]))
+                ret = EXIT_FAILURE;
+        fflush(stdout);
+    } while (watch && !sleep(watch));
+    return ret;
+}
@@ -0,0 +1,146 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "param.h"
+#if PERF
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "profile.h"
+
+const char *const profile_names[PROFILE_PHASES] = {
+    "keygen", "errorgen", "dense", "syndrome", "threshold",
+    "counters", "flips", "bp", "total"};
+
+const char *const perf_names[PERF_EVENTS] = {
+    "instructions", "cycles", "l1d_misses", "llc_misses", "branch_misses"};
+
+#if PROFILE
+_Thread_local struct profile *profile_thread = NULL;
+
+/* End of the last instance of the thread */
+static _Thread_local uint64_t profile_last;
+
+#if PERF
+/* Hardware counters of the current thread, the first one leads the group (-1
+ * if unavailable) */
+static _Thread_local int perf_fds[PERF_EVENTS] = {-1};
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} perf_events[PERF_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+
+static void perf_close(void) {
+    for (int e = 0; e < PERF_EVENTS && perf_fds[e] >= 0; ++e)
+        close(perf_fds[e]);
+    perf_fds[0] = -1;
+}
+
+/* Open the counters of the current thread as a single group, so that they are
+ * scheduled together. Returns 0 on success, -1 if the counters are
+ * unavailable (no PMU, perf_event_paranoid, ...). */
+static int perf_open(void) {
+    int leader = -1;
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[e].type;
+        attr.config = perf_events[e].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (leader == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        perf_fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (e + 1 < PERF_EVENTS)
+            perf_fds[e + 1] = -1;
+        if (perf_fds[e] < 0) {
+            perf_close();
+            return -1;
+        }
+        leader = perf_fds[0];
+    }
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+/* Current values of the counters of the thread (zeros if unavailable) */
+void perf_read(uint64_t *events) {
+    struct {
+        uint64_t nr;
+        uint64_t values[PERF_EVENTS];
+    } group;
+    if (perf_fds[0] < 0 ||
+        read(perf_fds[0], &group, sizeof(group)) != sizeof(group)) {
+        memset(events, 0, PERF_EVENTS * sizeof(uint64_t));
+        return;
+    }
+    memcpy(events, group.values, PERF_EVENTS * sizeof(uint64_t));
+}
+#endif
+
+/* Account the phases of the current thread in 'p'. */
+void profile_start(struct profile *p) {
+    profile_thread = p;
+#if PERF
+    atomic_store(&p->perf, !perf_open());
+#endif
+    profile_last = profile_clock();
+}
+
+void profile_stop(void) {
+#if PERF
+    perf_close();
+#endif
+    profile_thread = NULL;
+}
+
+/* Called after each instance (or each batch of 'n' instances): the time since
+ * the previous call is added to the total. */
+void profile_instances(long int n) {
+    struct profile *p = profile_thread;
+    uint64_t now = profile_clock();
+    if (p) {
+        uint64_t cycles = atomic_load_explicit(&p->cycles[PROFILE_TOTAL],
+                                               memory_order_relaxed);
+        uint64_t count = atomic_load_explicit(&p->count[PROFILE_TOTAL],
+                                              memory_order_relaxed);
+        atomic_store_explicit(&p->cycles[PROFILE_TOTAL],
+                              cycles + now - profile_last,
+                              memory_order_relaxed);
+        atomic_store_explicit(&p->count[PROFILE_TOTAL], count + n,
+                              memory_order_relaxed);
+    }
+    profile_last = now;
+}
+#endif
@@ -19,17 +19,25 @@
    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
    IN THE SOFTWARE
 */
+#include <math.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "affinity.h"
+#include "capture.h"
+#include "checkpoint.h"
 #include "code.h"
 #include "codegen.h"
 #include "errorgen.h"
+#include "histogram.h"
 #include "param.h"
+#include "profile.h"
 #include "qcmdpc_decoder.h"
+#include "trace.h"
 #include "types.h"
 #include "xoshiro256plusplus.h"
 
@@ -38,12 +46,27 @@
 #else
 #include "decoder.h"
 #endif
+#if BATCH
+#include "decoder_batch.h"
+#endif
+#ifdef JIT
+#include "jit.h"
+#endif
 
 void init_decoding_results(decoding_results_t *res, int n_threads,
                            int max_iter) {
     res->n_threads = n_threads;
     res->max_iter = max_iter;
     res->run = 0;
+    res->key_errors = 0;
+    res->key_callback = NULL;
+    res->resumed = NULL;
+    res->seed = 0;
+    res->first = 0;
+    res->count = -1;
+    res->shard_index = 0;
+    res->shard_count = 1;
+    atomic_init(&res->next, 0);
 
     res->n_test = calloc(n_threads, sizeof(long int));
     res->n_success = calloc(n_threads, sizeof(long int));
@@ -51,6 +74,57 @@ void init_decoding_results(decoding_results_t *res, int n_threads,
     for (index_t i = 0; i < n_threads; ++i) {
         res->n_iter[i] = calloc(max_iter + 1, sizeof(long int));
     }
+    res->seq = malloc(n_threads * sizeof(atomic_uint));
+    for (index_t i = 0; i < n_threads; ++i) {
+        atomic_init(&res->seq[i], 0);
+    }
+    pthread_mutex_init(&res->cut_lock, NULL);
+    res->cut_results = malloc(sizeof(struct checkpoint));
+    checkpoint_init(res->cut_results, "", max_iter);
+    res->cut = 0;
+    atomic_init(&res->cut_generation, 0);
+    res->cut_seen = calloc(n_threads, sizeof(unsigned));
+    res->cut_done = calloc(n_threads, sizeof(int));
+    res->cut_broken = 0;
+    res->cut_pending = 0;
+    res->tilt = NULL;
+    res->split = NULL;
+    res->split_levels = 0;
+    res->split_copies = 1;
+    res->stratum_width = 0;
+    res->stratum_min = 0;
+    res->stratum_pilot = 0;
+    res->stratum_rate = NULL;
+    res->n_skipped = calloc(n_threads, sizeof(long int));
+    res->capture = NULL;
+    res->capture_slow = 0;
+    res->trace = NULL;
+    res->trace_rate = 1;
+    res->histogram = NULL;
+    res->histogram_rate = 1;
+    res->corpus = NULL;
+    res->cpus = NULL;
+    res->n_cpus = 0;
+    res->profile = calloc(n_threads, sizeof(struct profile));
+    res->fail_blocked = calloc(n_threads, sizeof(long int));
+    res->fail_syndrome = malloc(n_threads * sizeof(long int *));
+    res->fail_error = malloc(n_threads * sizeof(long int *));
+    res->fail_stall = malloc(n_threads * sizeof(long int *));
+    for (index_t i = 0; i < n_threads; ++i) {
+        res->fail_syndrome[i] = calloc(BLOCK_LENGTH + 1, sizeof(long int));
+        res->fail_error[i] = calloc(INDEX * BLOCK_LENGTH + 1, sizeof(long int));
+        res->fail_stall[i] = calloc(max_iter + 1, sizeof(long int));
+    }
+    res->latency = malloc(n_threads * sizeof(long int *));
+    for (index_t i = 0; i < n_threads; ++i)
+        res->latency[i] =
+            calloc(LATENCY_KINDS * LATENCY_BUCKETS, sizeof(long int));
+    res->w1 = malloc(n_threads * sizeof(double *));
+    res->w2 = malloc(n_threads * sizeof(double *));
+    for (index_t i = 0; i < n_threads; ++i) {
+        res->w1[i] = calloc(max_iter + 2, sizeof(double));
+        res->w2[i] = calloc(max_iter + 2, sizeof(double));
+    }
 }
 
 void clear_decoding_results(decoding_results_t *res) {
@@ -60,6 +134,33 @@ void clear_decoding_results(decoding_results_t *res) {
         free(res->n_iter[i]);
     }
     free(res->n_iter);
+    free(res->seq);
+    pthread_mutex_destroy(&res->cut_lock);
+    checkpoint_clear(res->cut_results);
+    free(res->cut_results);
+    free(res->cut_seen);
+    free(res->cut_done);
+    for (index_t i = 0; i < res->n_threads; ++i) {
+        free(res->w1[i]);
+        free(res->w2[i]);
+    }
+    free(res->w1);
+    free(res->w2);
+    free(res->n_skipped);
+    free(res->stratum_rate);
+    free(res->profile);
+    for (index_t i = 0; i < res->n_threads; ++i) {
+        free(res->fail_syndrome[i]);
+        free(res->fail_error[i]);
+        free(res->fail_stall[i]);
+    }
+    free(res->fail_blocked);
+    free(res->fail_syndrome);
+    free(res->fail_error);
+    free(res->fail_stall);
+    for (index_t i = 0; i < res->n_threads; ++i)
+        free(res->latency[i]);
+    free(res->latency);
 }
 
 void sum_decoding_results(long int *test_total, long int *success_total,
@@ -67,147 +168,1217 @@ void sum_decoding_results(long int *test_total, long int *success_total,
     *test_total = 0;
     *success_total = 0;
     memset(iter_total, 0, (res->max_iter + 1) * sizeof(long int));
+    if (res->resumed) {
+        *test_total = res->resumed->n_test;
+        *success_total = res->resumed->n_success;
+        memcpy(iter_total, res->resumed->n_iter,
+               (res->max_iter + 1) * sizeof(long int));
+    }
 
+    long int n_iter[res->max_iter + 1];
     for (int i = 0; i < res->n_threads; ++i) {
-        *test_total += res->n_test[i];
-        *success_total += res->n_success[i];
+        /* Retry until the results of the thread were not updated while being
+         * read, so that the totals are consistent. */
+        long int n_test;
+        long int n_success;
+        unsigned seq;
+        do {
+            while ((seq = atomic_load_explicit(&res->seq[i],
+                                               memory_order_acquire)) &
+                   1)
+                ;
+            n_test = res->n_test[i];
+            n_success = res->n_success[i];
+            memcpy(n_iter, res->n_iter[i],
+                   (res->max_iter + 1) * sizeof(long int));
+            atomic_thread_fence(memory_order_acquire);
+        } while (atomic_load_explicit(&res->seq[i], memory_order_relaxed) !=
+                 seq);
+
+        *test_total += n_test;
+        *success_total += n_success;
+        for (int it = 0; it <= res->max_iter; ++it) {
+            iter_total[it] += n_iter[it];
+        }
     }
+}
 
+/* Number of instances decoded by each thread (without the resumed ones) */
+void thread_decoding_results(long int *test, const decoding_results_t *res) {
     for (int i = 0; i < res->n_threads; ++i) {
-        for (int it = 0; it <= res->max_iter; ++it) {
-            iter_total[it] += res->n_iter[i][it];
+        unsigned seq;
+        do {
+            while ((seq = atomic_load_explicit(&res->seq[i],
+                                               memory_order_acquire)) &
+                   1)
+                ;
+            test[i] = res->n_test[i];
+            atomic_thread_fence(memory_order_acquire);
+        } while (atomic_load_explicit(&res->seq[i], memory_order_relaxed) !=
+                 seq);
+    }
+}
+
+/* Whether the instances are weighted (importance sampling, splitting or
+ * stratified sampling). */
+int weighted_results(const decoding_results_t *res) {
+    return res->tilt || res->split_levels || res->stratum_width;
+}
+
+/* Sums of the weights (and of their squares) of the instances decoded in each
+ * number of iterations, the failures are at index max_iter + 1, and number of
+ * instances that were not decoded. */
+void sum_weighted_results(long int *skipped_total, double *w1_total,
+                          double *w2_total, const decoding_results_t *res) {
+    *skipped_total = 0;
+    memset(w1_total, 0, (res->max_iter + 2) * sizeof(double));
+    memset(w2_total, 0, (res->max_iter + 2) * sizeof(double));
+
+    double w1[res->max_iter + 2];
+    double w2[res->max_iter + 2];
+    for (int i = 0; i < res->n_threads; ++i) {
+        long int skipped;
+        unsigned seq;
+        do {
+            while ((seq = atomic_load_explicit(&res->seq[i],
+                                               memory_order_acquire)) &
+                   1)
+                ;
+            skipped = res->n_skipped[i];
+            memcpy(w1, res->w1[i], (res->max_iter + 2) * sizeof(double));
+            memcpy(w2, res->w2[i], (res->max_iter + 2) * sizeof(double));
+            atomic_thread_fence(memory_order_acquire);
+        } while (atomic_load_explicit(&res->seq[i], memory_order_relaxed) !=
+                 seq);
+
+        *skipped_total += skipped;
+        for (int it = 0; it <= res->max_iter + 1; ++it) {
+            w1_total[it] += w1[it];
+            w2_total[it] += w2[it];
         }
     }
 }
 
-struct process_args {
-    /* Number of test rounds */
-    long int r;
-    /* PRNG seeds */
-    uint64_t s[4];
+/* Histograms of the failures of all the threads, see decoding_results_t */
+void sum_failure_results(long int *blocked_total, long int *syndrome_total,
+                         long int *error_total, long int *stall_total,
+                         const decoding_results_t *res) {
+    *blocked_total = 0;
+    memset(syndrome_total, 0, (BLOCK_LENGTH + 1) * sizeof(long int));
+    memset(error_total, 0, (INDEX * BLOCK_LENGTH + 1) * sizeof(long int));
+    memset(stall_total, 0, (res->max_iter + 1) * sizeof(long int));
+    if (res->resumed) {
+        *blocked_total = res->resumed->fail_blocked;
+        memcpy(syndrome_total, res->resumed->fail_syndrome,
+               (BLOCK_LENGTH + 1) * sizeof(long int));
+        memcpy(error_total, res->resumed->fail_error,
+               (INDEX * BLOCK_LENGTH + 1) * sizeof(long int));
+        memcpy(stall_total, res->resumed->fail_stall,
+               (res->max_iter + 1) * sizeof(long int));
+    }
 
-    int id;
+    long int *syndrome = malloc((BLOCK_LENGTH + 1) * sizeof(long int));
+    long int *error = malloc((INDEX * BLOCK_LENGTH + 1) * sizeof(long int));
+    long int *stall = malloc((res->max_iter + 1) * sizeof(long int));
+    for (int i = 0; i < res->n_threads; ++i) {
+        long int blocked;
+        unsigned seq;
+        do {
+            while ((seq = atomic_load_explicit(&res->seq[i],
+                                               memory_order_acquire)) &
+                   1)
+                ;
+            blocked = res->fail_blocked[i];
+            memcpy(syndrome, res->fail_syndrome[i],
+                   (BLOCK_LENGTH + 1) * sizeof(long int));
+            memcpy(error, res->fail_error[i],
+                   (INDEX * BLOCK_LENGTH + 1) * sizeof(long int));
+            memcpy(stall, res->fail_stall[i],
+                   (res->max_iter + 1) * sizeof(long int));
+            atomic_thread_fence(memory_order_acquire);
+        } while (atomic_load_explicit(&res->seq[i], memory_order_relaxed) !=
+                 seq);
 
-    long int thread_iter;
+        *blocked_total += blocked;
+        for (index_t w = 0; w <= BLOCK_LENGTH; ++w)
+            syndrome_total[w] += syndrome[w];
+        for (index_t w = 0; w <= INDEX * BLOCK_LENGTH; ++w)
+            error_total[w] += error[w];
+        for (int it = 0; it <= res->max_iter; ++it)
+            stall_total[it] += stall[it];
+    }
+    free(syndrome);
+    free(error);
+    free(stall);
+}
 
-    decoding_results_t *results;
-};
+/* Histograms of the latencies of all the threads, see decoding_results_t */
+void sum_latency_results(long int (*latency_total)[LATENCY_BUCKETS],
+                         const decoding_results_t *res) {
+    memset(latency_total, 0,
+           LATENCY_KINDS * LATENCY_BUCKETS * sizeof(long int));
+    if (res->resumed)
+        memcpy(latency_total, res->resumed->latency,
+               LATENCY_KINDS * LATENCY_BUCKETS * sizeof(long int));
 
-void *process(void *arg) {
-    struct process_args *args = arg;
+    long int *latency =
+        malloc(LATENCY_KINDS * LATENCY_BUCKETS * sizeof(long int));
+    for (int i = 0; i < res->n_threads; ++i) {
+        unsigned seq;
+        do {
+            while ((seq = atomic_load_explicit(&res->seq[i],
+                                               memory_order_acquire)) &
+                   1)
+                ;
+            memcpy(latency, res->latency[i],
+                   LATENCY_KINDS * LATENCY_BUCKETS * sizeof(long int));
+            atomic_thread_fence(memory_order_acquire);
+        } while (atomic_load_explicit(&res->seq[i], memory_order_relaxed) !=
+                 seq);
 
-    long int iter = args->thread_iter;
-    decoding_results_t *results = args->results;
-    int tid = args->id;
+        for (int k = 0; k < LATENCY_KINDS; ++k)
+            for (int b = 0; b < LATENCY_BUCKETS; ++b)
+                latency_total[k][b] += latency[k * LATENCY_BUCKETS + b];
+    }
+    free(latency);
+}
 
-    code_t H;
-    e_t e __attribute__((aligned(32)));
-    syndrome_t syndrome __attribute__((aligned(32)));
+/* Time spent in each phase by all the threads, see profile.h (only accounted
+ * when built with PROFILE) */
+void sum_profile_results(uint64_t *cycles_total, uint64_t *count_total,
+                         const decoding_results_t *res) {
+    for (int p = 0; p < PROFILE_PHASES; ++p) {
+        cycles_total[p] = 0;
+        count_total[p] = 0;
+        for (int i = 0; i < res->n_threads; ++i) {
+            cycles_total[p] += atomic_load_explicit(
+                &res->profile[i].cycles[p], memory_order_relaxed);
+            count_total[p] += atomic_load_explicit(&res->profile[i].count[p],
+                                                   memory_order_relaxed);
+        }
+    }
+}
 
-    /* Error pattern */
-    index_t error_sparse[ERROR_WEIGHT];
+#if PERF
+/* Hardware events in each phase summed over the threads where they were
+ * counted. Returns the number of such threads. */
+int sum_perf_results(uint64_t (*events_total)[PERF_EVENTS],
+                     const decoding_results_t *res) {
+    int n = 0;
+    memset(events_total, 0, PROFILE_PHASES * sizeof(*events_total));
+    for (int i = 0; i < res->n_threads; ++i) {
+        if (!atomic_load(&res->profile[i].perf))
+            continue;
+        ++n;
+        for (int p = 0; p < PROFILE_PHASES; ++p)
+            for (int e = 0; e < PERF_EVENTS; ++e)
+                events_total[p][e] += atomic_load_explicit(
+                    &res->profile[i].events[p][e], memory_order_relaxed);
+    }
+    return n;
+}
+#endif
 
-    /* Error pattern on the syndrome (for Ouroboros) */
-#if OUROBOROS
-    index_t syndrome_error_sparse[ERROR_WEIGHT / 2];
+/* Enclose the updates of the results of thread 'tid'. */
+static void results_update_begin(decoding_results_t *res, int tid) {
+    atomic_fetch_add_explicit(&res->seq[tid], 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void results_update_end(decoding_results_t *res, int tid) {
+    atomic_fetch_add_explicit(&res->seq[tid], 1, memory_order_release);
+}
+
+/* Record the result of an instance of likelihood ratio 'weight', between
+ * results_update_begin and results_update_end. */
+static void add_result(decoding_results_t *res, int tid, int success, int iter,
+                       double weight) {
+    if (success) {
+        res->n_success[tid]++;
+        res->n_iter[tid][iter]++;
+    }
+    res->n_test[tid]++;
+    if (weighted_results(res) && !res->split_levels) {
+        int i = success ? iter : res->max_iter + 1;
+        res->w1[tid][i] += weight;
+        res->w2[tid][i] += weight * weight;
+    }
+}
+
+#if (ALGO == SBS) || (ALGO == SORT)
+/* Record the result of an instance decoded with splitting, 'x' is the total
+ * weight of its copies by number of iterations (failures last) and 'success'
+ * and 'iter' the result of its first copy, which is an ordinary trajectory. */
+static void add_split_result(decoding_results_t *res, int tid, int success,
+                             int iter, const double *x) {
+    add_result(res, tid, success, iter, 0);
+    double tail = 0;
+    for (int i = res->max_iter + 1; i >= 0; --i) {
+        tail += x[i];
+        res->w1[tid][i] += x[i];
+        res->w2[tid][i] += tail * tail;
+    }
+}
 #endif
 
-#if (ALGO == BP)
-    decoder_bp_t dec = aligned_alloc(32, sizeof(struct decoder_bp));
+/* Hand an instance over to the capture writer if it failed (iter is then -1)
+ * or was slow to decode. */
+static void capture_instance(decoding_results_t *res, int tid, const code_t *H,
+                             long int key, long int index,
+                             const sparse_t error_sparse,
+                             const sparse_t syndrome_error_sparse, int iter,
+                             double weight) {
+    if (!res->capture ||
+        (iter >= 0 && (!res->capture_slow || iter < res->capture_slow)))
+        return;
+    struct capture_record *r = capture_reserve(res->capture, tid);
+    if (!r)
+        return;
+    r->key = key;
+    r->index = index;
+    r->iter = iter;
+    r->reserved = 0;
+    r->weight = weight;
+    for (index_t k = 0; k < INDEX; ++k)
+        for (index_t l = 0; l < BLOCK_WEIGHT; ++l)
+            r->columns[k][l] = H->columns[k][l];
+    for (index_t i = 0; i < ERROR_WEIGHT; ++i)
+        r->error[i] = error_sparse[i];
+#if OUROBOROS
+    for (index_t i = 0; i < SYNDROME_STOP; ++i)
+        r->syndrome_error[i] = syndrome_error_sparse[i];
 #else
-    decoder_t dec = aligned_alloc(32, sizeof(struct decoder));
+    (void)syndrome_error_sparse;
 #endif
+    capture_commit(res->capture, tid);
+}
 
-    struct PRNG prng;
-    memcpy(prng.s, args->s, 4 * sizeof(uint64_t));
-    prng.random_lim = random_lim;
-    prng.random_uint64_t = random_uint64_t;
-
-    for (int i = 0; i < tid; ++i) {
-        jump(prng.s);
-    }
-    init_decoder(dec, &H, &e, &syndrome);
+/* Parity check matrix and error patterns of a replayed instance */
+static void load_instance(const struct capture_record *r, code_t *H,
+                          sparse_t error_sparse,
+                          sparse_t syndrome_error_sparse) {
+    for (index_t k = 0; k < INDEX; ++k)
+        for (index_t l = 0; l < BLOCK_WEIGHT; ++l)
+            H->columns[k][l] = r->columns[k][l];
+    transpose_columns(H);
+    for (index_t i = 0; i < ERROR_WEIGHT; ++i)
+        error_sparse[i] = r->error[i];
+#if OUROBOROS
+    for (index_t i = 0; i < SYNDROME_STOP; ++i)
+        syndrome_error_sparse[i] = r->syndrome_error[i];
+#else
+    (void)syndrome_error_sparse;
+#endif
+}
 
-    ++results->run;
-    while (results->run && (iter == -1 || results->n_test[tid] < iter)) {
+static void generate_code(code_t *H, prng_t prng) {
 #if WEAK == 1
-        generate_weak_type1(&H, &prng);
+    generate_weak_type1(H, prng);
 #elif WEAK == 2
-        generate_weak_type2(&H, &prng);
+    generate_weak_type2(H, prng);
 #elif WEAK == 3
-        generate_weak_type3(&H, &prng);
+    generate_weak_type3(H, prng);
 #else
-        generate_random_code(&H, &prng);
+    generate_random_code(H, prng);
 #endif
+}
 
+/* Returns the likelihood ratio of the error pattern (1 unless importance
+ * sampling is used). */
+static double generate_error(sparse_t error_sparse, code_t *H,
+                             const decoding_results_t *res, prng_t prng) {
+    if (res->tilt)
+        return generate_tilted_error(error_sparse, H, res->tilt, prng);
 #if ERROR_FLOOR == 1
-        generate_near_codeword(error_sparse, &H, &prng);
+    generate_near_codeword(error_sparse, H, prng);
 #elif ERROR_FLOOR == 2
-        generate_near_codeword2(error_sparse, &H, &prng);
+    generate_near_codeword2(error_sparse, H, prng);
 #elif ERROR_FLOOR == 3
-        generate_codeword(error_sparse, &H, &prng);
+    generate_codeword(error_sparse, H, prng);
 #else
-        generate_random_error(error_sparse, ERROR_WEIGHT, &prng);
+    (void)H;
+    generate_random_error(error_sparse, ERROR_WEIGHT, prng);
 #endif
+    return 1.;
+}
+
+/* Streams of random numbers derived from the seed */
+#define STREAM_INSTANCE 0
+#define STREAM_KEY 1
+#define STREAM_KEY_ERROR 2
+#define STREAM_TRACE 3
+#define STREAM_HISTOGRAM 4
+#define STREAM_STRATUM 5
+#define STREAM_PILOT 6
+
+static void init_instance_prng(struct PRNG *prng, const decoding_results_t *res,
+                               uint64_t stream, long int index) {
+    seed_instance(prng->s, res->seed, stream, index);
+}
+
+#if (ALGO != BP)
+/* Whether instance 'index' is sampled (traced, or its counters recorded): a
+ * fraction 'rate' of the instances, drawn from their own stream so that the
+ * instances do not depend on it */
+static int sampled(const decoding_results_t *res, uint64_t stream, double rate,
+                   long int index) {
+    if (rate >= 1)
+        return 1;
+    uint64_t s[4];
+    seed_instance(s, res->seed, stream, index);
+    return (s[0] >> 11) * 0x1.0p-53 < rate;
+}
+#endif
+
+/* Hand out the numbers of the next 'n' instances to decode. Returns how many
+ * were stored in 'indices' (less than 'n' when all the instances were handed
+ * out), the value of n (see decoding_results) of the first one is stored in
+ * 'first_n'. */
+static long int next_instances(decoding_results_t *res, long int n,
+                               long int *indices, long int *first_n) {
+    long int next = atomic_load(&res->next);
+    long int k;
+    /* 'next' is only advanced by the instances actually handed out, so that
+     * it can be saved and resumed. */
+    do {
+        for (k = 0; k < n; ++k) {
+            long int index =
+                res->first + res->shard_index + (next + k) * res->shard_count;
+            if (res->count != -1 && index >= res->first + res->count)
+                break;
+            indices[k] = index;
+        }
+    } while (k && !atomic_compare_exchange_weak(&res->next, &next, next + k));
+    *first_n = next;
+    return k;
+}
+
+/* Add the results of thread 'tid' to 'cp'. */
+static void add_thread_checkpoint(struct checkpoint *cp,
+                                  const decoding_results_t *res, int tid) {
+    cp->n_test += res->n_test[tid];
+    cp->n_success += res->n_success[tid];
+    cp->fail_blocked += res->fail_blocked[tid];
+    for (int it = 0; it <= res->max_iter; ++it) {
+        cp->n_iter[it] += res->n_iter[tid][it];
+        cp->fail_stall[it] += res->fail_stall[tid][it];
+    }
+    for (long int i = 0; i < cp->syndrome_length; ++i)
+        cp->fail_syndrome[i] += res->fail_syndrome[tid][i];
+    for (long int i = 0; i < cp->error_length; ++i)
+        cp->fail_error[i] += res->fail_error[tid][i];
+    for (int i = 0; i < LATENCY_KINDS * LATENCY_BUCKETS; ++i)
+        cp->latency[i] += res->latency[tid][i];
+}
+
+/* Called by thread 'tid' before it decodes the instances from n = 'n' on: the
+ * instances it decoded so far are all before 'n', they are included in the
+ * pending checkpoint if it is cut there. */
+static void checkpoint_cross(decoding_results_t *res, int tid, long int n) {
+    unsigned generation = atomic_load(&res->cut_generation);
+    if (generation == res->cut_seen[tid])
+        return;
+    pthread_mutex_lock(&res->cut_lock);
+    generation = atomic_load(&res->cut_generation);
+    if (res->cut_seen[tid] != generation && n >= res->cut) {
+        add_thread_checkpoint(res->cut_results, res, tid);
+        res->cut_seen[tid] = generation;
+        --res->cut_pending;
+    }
+    pthread_mutex_unlock(&res->cut_lock);
+}
+
+/* Called by thread 'tid' when it stops, 'done' is 2 if it stopped in the
+ * middle of a key. */
+static void checkpoint_stop(decoding_results_t *res, int tid, int done) {
+    pthread_mutex_lock(&res->cut_lock);
+    if (res->cut_seen[tid] != atomic_load(&res->cut_generation)) {
+        if (done == 2)
+            res->cut_broken = 1;
+        else
+            add_thread_checkpoint(res->cut_results, res, tid);
+        res->cut_seen[tid] = atomic_load(&res->cut_generation);
+        --res->cut_pending;
+    }
+    res->cut_done[tid] = done;
+    pthread_mutex_unlock(&res->cut_lock);
+}
 
-        reset_decoder(dec);
-        error_sparse_to_dense(&e, error_sparse, ERROR_WEIGHT);
+/* Start a checkpoint at the instances handed out so far. The threads add
+ * their results once they decoded all the instances they were handed out
+ * before it, decoder_checkpoint_collect then returns them. */
+void decoder_checkpoint_start(decoding_results_t *res) {
+    pthread_mutex_lock(&res->cut_lock);
+    checkpoint_clear(res->cut_results);
+    checkpoint_init(res->cut_results, "", res->max_iter);
+    /* The new generation is published before 'next' is read: a thread
+     * handed out an instance after the read sees it in checkpoint_cross (both
+     * are sequentially consistent), and waits for the cut on the lock. */
+    unsigned generation = atomic_load(&res->cut_generation) + 1;
+    atomic_store(&res->cut_generation, generation);
+    res->cut = atomic_load(&res->next);
+    res->cut_broken = 0;
+    int pending = 0;
+    for (int i = 0; i < res->n_threads; ++i) {
+        if (!res->cut_done[i]) {
+            ++pending;
+            continue;
+        }
+        if (res->cut_done[i] == 2)
+            res->cut_broken = 1;
+        else
+            add_thread_checkpoint(res->cut_results, res, i);
+        res->cut_seen[i] = generation;
+    }
+    res->cut_pending = pending;
+    pthread_mutex_unlock(&res->cut_lock);
+}
+
+/* Add the results of the last checkpoint started (and of the resumed one) to
+ * 'cp' and set cp->next. Returns 0 if some threads did not add their results
+ * yet, or -1 if the checkpoint cannot be completed (a thread stopped in the
+ * middle of a key). */
+int decoder_checkpoint_collect(decoding_results_t *res, struct checkpoint *cp) {
+    int ret = 1;
+    pthread_mutex_lock(&res->cut_lock);
+    if (res->cut_broken) {
+        ret = -1;
+    } else if (res->cut_pending) {
+        ret = 0;
+    } else {
+        checkpoint_add(cp, res->cut_results);
+        if (res->resumed)
+            checkpoint_add(cp, res->resumed);
+        cp->next = res->cut;
+    }
+    pthread_mutex_unlock(&res->cut_lock);
+    return ret;
+}
+
+#if (ALGO == BP)
+typedef decoder_bp_t qcmdpc_decoder_t;
+#else
+typedef decoder_t qcmdpc_decoder_t;
+#endif
+
+/* Record the final state of a failed instance, between results_update_begin
+ * and results_update_end. */
+static void add_failure(decoding_results_t *res, int tid,
+                        qcmdpc_decoder_t dec) {
+    res->fail_syndrome[tid][dec->syndrome->weight]++;
+    res->fail_error[tid][dec->e->weight]++;
+    res->fail_stall[tid][(dec->min_iter < res->max_iter) ? dec->min_iter
+                                                          : res->max_iter]++;
+#if (ALGO != BP)
+    res->fail_blocked[tid] += dec->blocked;
+#endif
+}
+
+/* Record the latencies of an instance, between results_update_begin and
+ * results_update_end. */
+static void add_latency(decoding_results_t *res, int tid, int success,
+                        uint64_t setup, uint64_t decode) {
+    long int *latency = res->latency[tid];
+    latency[LATENCY_SETUP * LATENCY_BUCKETS + latency_bucket(setup)]++;
+    latency[(success ? LATENCY_SUCCESS : LATENCY_FAILURE) * LATENCY_BUCKETS +
+            latency_bucket(decode)]++;
+}
+
+/* Set the decoder up to decode the error pattern 'error_sparse' with the
+ * parity check matrix of 'dec'. The error pattern on the syndrome (for
+ * Ouroboros) is 'syndrome_error_sparse', drawn first if 'draw' is set. */
+static void prepare_error(qcmdpc_decoder_t dec, const sparse_t error_sparse,
+                          sparse_t syndrome_error_sparse, int draw,
+                          prng_t prng) {
+    (void)prng;
+    reset_decoder(dec);
+    PROFILE_BEGIN(PROFILE_DENSE);
+    error_sparse_to_dense(dec->e, error_sparse, ERROR_WEIGHT);
+    PROFILE_END(PROFILE_DENSE);
 
+    PROFILE_BEGIN(PROFILE_SYNDROME);
 #if (ALGO == BP)
-        init_bp(dec, &prng);
+    init_bp(dec, prng);
 #else
-        compute_syndrome(&syndrome, &H, &e);
+    compute_syndrome(dec->syndrome, dec->H, dec->e);
 #endif
+    PROFILE_END(PROFILE_SYNDROME);
 
+    /* Error pattern on the syndrome (for Ouroboros) */
 #if OUROBOROS
+    if (draw)
         generate_random_syndrome_error(syndrome_error_sparse, SYNDROME_STOP,
-                                       &prng);
-        syndrome_add_sparse_error(&syndrome, syndrome_error_sparse,
-                                  SYNDROME_STOP);
+                                       prng);
+    syndrome_add_sparse_error(dec->syndrome, syndrome_error_sparse,
+                              SYNDROME_STOP);
+#else
+    (void)syndrome_error_sparse;
+    (void)draw;
+#endif
+}
+
+#if (ALGO == SBS) || (ALGO == SORT)
+/* State of a trajectory when it reaches a splitting level */
+struct split_state {
+    syndrome_t syndrome;
+    bits_t bits;
+    index_t e_weight;
+    index_t iter;
+    bool blocked;
+    struct sbs_state sbs;
+};
+#endif
+
+/* Strata with fewer pilot instances are always decoded */
+#define STRATUM_PILOT 100
+
+/* Per-thread buffers */
+struct work {
+#if (ALGO == SBS) || (ALGO == SORT)
+    /* Splitting: one state per level */
+    struct split_state *states;
+    /* Splitting: total weight of the copies by number of iterations, failures
+     * last */
+    double *x;
+#endif
+    /* Clock at the start of the setup of the current instance */
+    uint64_t start;
+#if (ALGO != BP)
+    /* Tracing: instance currently traced by the thread */
+    struct trace_target trace;
+    /* Instance whose counters are currently recorded by the thread */
+    struct histogram_target histogram;
+#endif
+};
+
+static void alloc_work(struct work *w, const decoding_results_t *res,
+                       int tid) {
+#if (ALGO == SBS) || (ALGO == SORT)
+    w->states = NULL;
+    w->x = NULL;
+    if (res->split_levels) {
+        w->states =
+            aligned_alloc(64, res->split_levels * sizeof(struct split_state));
+        w->x = malloc((res->max_iter + 2) * sizeof(double));
+    }
+#endif
+#if (ALGO != BP)
+    w->trace.c = res->trace;
+    w->trace.tid = tid;
+    w->histogram.c = res->histogram;
+    w->histogram.tid = tid;
+#else
+    (void)w;
+    (void)res;
+    (void)tid;
+#endif
+}
+
+static void free_work(struct work *w) {
+#if (ALGO == SBS) || (ALGO == SORT)
+    free(w->states);
+    free(w->x);
+#else
+    (void)w;
+#endif
+}
+
+#if (ALGO == SBS) || (ALGO == SORT)
+/* Continue the trajectory of 'dec' of weight 'weight' from level 'level',
+ * copying it at each level it reaches. The weights of the copies are added to
+ * w->x. Returns the result of the first copy, its number of iterations is
+ * stored in 'iter'. */
+static int split_decode(decoder_t dec, const decoding_results_t *res,
+                        int level, double weight, struct work *w,
+                        index_t *iter, prng_t prng) {
+    for (; level < res->split_levels; ++level) {
+        const struct split_level *l = &res->split[level];
+        qcmdpc_decode(dec, l->iter, prng);
+        /* Trajectories that were decoded or got stuck do not reach the
+         * level. */
+        if (dec->iter < l->iter || dec->syndrome->weight < l->weight)
+            continue;
+
+        struct split_state *st = &w->states[level];
+        memcpy(&st->syndrome, dec->syndrome, sizeof(syndrome_t));
+        memcpy(st->bits, dec->bits, sizeof(bits_t));
+        st->e_weight = dec->e->weight;
+        st->iter = dec->iter;
+        st->blocked = dec->blocked;
+        st->sbs = dec->sbs;
+
+        /* The first copy continues the trajectory, the others continue its
+         * state with fresh randomness. */
+        int success = split_decode(dec, res, level + 1,
+                                   weight / res->split_copies, w, iter, prng);
+        for (int c = 1; c < res->split_copies; ++c) {
+            memcpy(dec->syndrome, &st->syndrome, sizeof(syndrome_t));
+            memcpy(dec->bits, st->bits, sizeof(bits_t));
+            dec->e->weight = st->e_weight;
+            dec->iter = st->iter;
+            dec->blocked = st->blocked;
+            dec->sbs = st->sbs;
+            decoder_reseed(dec, prng);
+
+            index_t unused;
+            split_decode(dec, res, level + 1, weight / res->split_copies, w,
+                         &unused, prng);
+        }
+        return success;
+    }
+
+    int success = qcmdpc_decode(dec, res->max_iter, prng);
+    *iter = dec->iter;
+    w->x[success ? dec->iter : res->max_iter + 1] += weight;
+    return success;
+}
+#endif
+
+#if (ALGO != BP)
+struct pilot_args {
+    decoding_results_t *results;
+    /* Next pilot instance */
+    atomic_long *next;
+    /* Number of pilot instances and of failures by stratum */
+    long int *decoded;
+    long int *failed;
+};
+
+/* Decode pilot instances. They are drawn from their own stream, so that they
+ * are independent of the instances of the campaign and the same for all its
+ * shards. */
+static void *pilot(void *arg) {
+    struct pilot_args *args = arg;
+    decoding_results_t *results = args->results;
+
+    code_t H;
+    e_t e __attribute__((aligned(32)));
+    syndrome_t syndrome __attribute__((aligned(32)));
+    index_t error_sparse[ERROR_WEIGHT];
+    index_t syndrome_error_sparse[ERROR_WEIGHT / 2];
+
+    decoder_t dec = aligned_alloc(64, sizeof(*dec));
+    init_decoder(dec, &H, &e, &syndrome);
+
+    struct PRNG prng;
+    long int index;
+    while (results->run && (index = atomic_fetch_add(args->next, 1)) <
+                               results->stratum_pilot) {
+        init_instance_prng(&prng, results, STREAM_PILOT, index);
+        generate_code(&H, &prng);
+        generate_error(error_sparse, &H, results, &prng);
+        prepare_error(dec, error_sparse, syndrome_error_sparse, 1, &prng);
+        index_t h = dec->syndrome->weight / results->stratum_width;
+#if (ALGO == SBS) || (ALGO == SORT)
+        int success = qcmdpc_decode(dec, results->max_iter, &prng);
+#else
+        int success = qcmdpc_decode(dec, results->max_iter);
 #endif
+        ++args->decoded[h];
+        args->failed[h] += !success;
+    }
 
+    free(dec);
+    return NULL;
+}
+
+/* Fix the probability to decode an instance of each stratum from the pilot:
+ * strata are sampled proportionally to the standard deviation of their
+ * outcome (Neyman allocation), the stratum with the largest one is always
+ * decoded. The decision to decode an instance then only depends on the seed
+ * and on its number, not on the threads. */
+static void stratum_pilot(decoding_results_t *res, int n_threads) {
+    index_t strata = BLOCK_LENGTH / res->stratum_width + 1;
+    atomic_long next;
+    atomic_init(&next, 0);
+    struct pilot_args args[n_threads];
+    pthread_t threads[n_threads];
+    for (int i = 0; i < n_threads; ++i) {
+        args[i].results = res;
+        args[i].next = &next;
+        args[i].decoded = calloc(strata, sizeof(long int));
+        args[i].failed = calloc(strata, sizeof(long int));
+        pthread_create(&threads[i], NULL, pilot, &args[i]);
+    }
+    for (int i = 0; i < n_threads; ++i)
+        pthread_join(threads[i], NULL);
+
+    double sigma[strata];
+    double sigma_max = 0;
+    long int decoded[strata];
+    for (index_t h = 0; h < strata; ++h) {
+        long int failed = 0;
+        decoded[h] = 0;
+        for (int i = 0; i < n_threads; ++i) {
+            decoded[h] += args[i].decoded[h];
+            failed += args[i].failed[h];
+        }
+        sigma[h] = 0;
+        if (decoded[h] >= STRATUM_PILOT) {
+            /* Half a failure is added so that strata without failures are
+             * still sampled. */
+            double p = (failed + .5) / (decoded[h] + 1.);
+            sigma[h] = sqrt(p * (1 - p));
+        }
+        sigma_max = (sigma[h] > sigma_max) ? sigma[h] : sigma_max;
+    }
+    for (int i = 0; i < n_threads; ++i) {
+        free(args[i].decoded);
+        free(args[i].failed);
+    }
+
+    res->stratum_rate = malloc(strata * sizeof(double));
+    for (index_t h = 0; h < strata; ++h) {
+        double rate = 1.;
+        if (decoded[h] >= STRATUM_PILOT && sigma_max > 0) {
+            rate = sigma[h] / sigma_max;
+            rate = (rate > res->stratum_min) ? rate : res->stratum_min;
+        }
+        res->stratum_rate[h] = rate;
+    }
+}
+#endif
+
+/* Decode the error pattern 'error_sparse' of likelihood ratio 'weight' with
+ * the parity check matrix of 'dec' and record the result. The error pattern on
+ * the syndrome (for Ouroboros) is drawn in 'syndrome_error_sparse', unless
+ * instances are replayed. 'key' and 'index' are the numbers of the instance,
+ * only used to capture it. */
+static void decode_instance(qcmdpc_decoder_t dec, const sparse_t error_sparse,
+                            sparse_t syndrome_error_sparse, double weight,
+                            decoding_results_t *res, int tid, struct work *w,
+                            long int key, long int index, prng_t prng) {
+    prepare_error(dec, error_sparse, syndrome_error_sparse, !res->corpus,
+                  prng);
+
+#if (ALGO != BP)
+    /* Stratified sampling: only decode a fraction of the instances of each
+     * stratum, the decoded ones are weighted by the inverse of the
+     * fraction. */
+    if (res->stratum_width) {
+        index_t h = dec->syndrome->weight / res->stratum_width;
+        double rate = res->stratum_rate[h];
+        if (!sampled(res, STREAM_STRATUM, rate, index)) {
+            results_update_begin(res, tid);
+            res->n_skipped[tid]++;
+            results_update_end(res, tid);
+            return;
+        }
+        weight /= rate;
+    }
+
+    dec->trace = NULL;
+    if (res->trace && sampled(res, STREAM_TRACE, res->trace_rate, index)) {
+        w->trace.index = index;
+        w->trace.flips = 0;
+        dec->trace = &w->trace;
+    }
+    dec->histogram = NULL;
+    if (res->histogram &&
+        sampled(res, STREAM_HISTOGRAM, res->histogram_rate, index)) {
+        w->histogram.index = index;
+        dec->histogram = &w->histogram;
+    }
+#endif
+
+    int success;
+    index_t iter;
+#if (ALGO == SBS) || (ALGO == SORT)
+    if (res->split_levels) {
+        memset(w->x, 0, (res->max_iter + 2) * sizeof(double));
+        success = split_decode(dec, res, 0, weight, w, &iter, prng);
+
+        results_update_begin(res, tid);
+        add_split_result(res, tid, success, iter, w->x);
+        results_update_end(res, tid);
+    }
+    else
+#endif
+    {
+        uint64_t start = profile_clock();
 #if (ALGO == SBS) || (ALGO == SORT)
-        if (qcmdpc_decode(dec, results->max_iter, &prng)) {
+        success = qcmdpc_decode(dec, res->max_iter, prng);
 #else
-        if (qcmdpc_decode(dec, results->max_iter)) {
+        success = qcmdpc_decode(dec, res->max_iter);
 #endif
-            results->n_success[tid]++;
-            results->n_iter[tid][dec->iter]++;
+        uint64_t end = profile_clock();
+        iter = dec->iter;
+
+        results_update_begin(res, tid);
+        add_result(res, tid, success, iter, weight);
+        if (!success)
+            add_failure(res, tid, dec);
+        add_latency(res, tid, success, start - w->start, end - start);
+        results_update_end(res, tid);
+    }
+
+    capture_instance(res, tid, dec->H, key, index, error_sparse,
+                     syndrome_error_sparse, success ? iter : -1, weight);
+}
+
+/* State shared by the threads in per-key mode. */
+struct key_state {
+    /* Key currently decoded, read-only for the threads */
+    key_data_t *key;
+#ifdef JIT
+    /* Kernels generated for each key, NULL if unavailable */
+    struct jit *jit;
+#endif
+    /* Number of the current key, -1 when there are no more keys */
+    long int index;
+    /* Value of n (see decoding_results) of the current key */
+    long int n;
+    /* Set when the run stopped before all the errors of the current key were
+     * decoded */
+    int partial;
+    /* Next error pattern to decode with the current key */
+    atomic_long next_error;
+    /* Results before the current key */
+    long int n_test;
+    long int n_success;
+    long int *n_iter;
+    pthread_barrier_t barrier;
+};
+
+struct process_args {
+    int id;
+
+    decoding_results_t *results;
+
+    struct key_state *key_state;
+};
+
+void *process(void *arg) {
+    struct process_args *args = arg;
+
+    decoding_results_t *results = args->results;
+    int tid = args->id;
+
+    code_t H;
+    e_t e __attribute__((aligned(32)));
+    syndrome_t syndrome __attribute__((aligned(32)));
+
+    /* Error pattern */
+    index_t error_sparse[ERROR_WEIGHT];
+    /* Error pattern on the syndrome (for Ouroboros) */
+    index_t syndrome_error_sparse[ERROR_WEIGHT / 2];
+
+    qcmdpc_decoder_t dec = aligned_alloc(64, sizeof(*dec));
+    struct work w;
+    alloc_work(&w, results, tid);
+
+    struct PRNG prng;
+    init_decoder(dec, &H, &e, &syndrome);
+    profile_start(&results->profile[tid]);
+
+    ++results->run;
+    long int index;
+    long int n;
+    while (results->run && next_instances(results, 1, &index, &n)) {
+        checkpoint_cross(results, tid, n);
+        w.start = profile_clock();
+        init_instance_prng(&prng, results, STREAM_INSTANCE, index);
+        double weight = 1.;
+        if (results->corpus) {
+            load_instance(&results->corpus->records[index], &H, error_sparse,
+                          syndrome_error_sparse);
+        } else {
+            PROFILE_BEGIN(PROFILE_KEYGEN);
+            generate_code(&H, &prng);
+            PROFILE_END(PROFILE_KEYGEN);
+            PROFILE_BEGIN(PROFILE_ERRORGEN);
+            weight = generate_error(error_sparse, &H, results, &prng);
+            PROFILE_END(PROFILE_ERRORGEN);
         }
+        decode_instance(dec, error_sparse, syndrome_error_sparse, weight,
+                        results, tid, &w, -1, index, &prng);
+        profile_instances(1);
+    }
+    if (results->run)
+        --results->run;
+    checkpoint_stop(results, tid, 1);
+
+    profile_stop();
+    free_work(&w);
+    free(dec);
 
-        results->n_test[tid]++;
+    return NULL;
+}
+
+/* Pick the next key, only called by the first thread while the others wait on
+ * the barrier. */
+static void next_key(struct key_state *ks, decoding_results_t *results) {
+    if (ks->index >= 0 && atomic_load(&ks->next_error) >= results->key_errors &&
+        results->key_callback) {
+        /* All the errors of the previous key were decoded. */
+        long int n_test;
+        long int n_success;
+        long int n_iter[results->max_iter + 1];
+        sum_decoding_results(&n_test, &n_success, n_iter, results);
+        long int key_iter[results->max_iter + 1];
+        for (int it = 0; it <= results->max_iter; ++it) {
+            key_iter[it] = n_iter[it] - ks->n_iter[it];
+            ks->n_iter[it] = n_iter[it];
+        }
+        results->key_callback(results, ks->index, n_test - ks->n_test,
+                              n_success - ks->n_success, key_iter);
+        ks->n_test = n_test;
+        ks->n_success = n_success;
+    }
+
+    if (!results->run || !next_instances(results, 1, &ks->index, &ks->n)) {
+        ks->partial = ks->index >= 0 &&
+                      atomic_load(&ks->next_error) < results->key_errors;
+        ks->index = -1;
+        return;
+    }
+
+    struct PRNG prng;
+    PROFILE_BEGIN(PROFILE_KEYGEN);
+    init_instance_prng(&prng, results, STREAM_KEY, ks->index);
+    generate_code(&ks->key->H, &prng);
+    compute_key_data(ks->key);
+#ifdef JIT
+    ks->key->jit =
+        (ks->jit && !jit_compile(ks->jit, &ks->key->H)) ? ks->jit : NULL;
+#endif
+    PROFILE_END(PROFILE_KEYGEN);
+    atomic_store(&ks->next_error, 0);
+}
+
+/* Decode 'results->key_errors' error patterns for each key. Keys are generated
+ * by the first thread and shared by all the threads. */
+void *process_key(void *arg) {
+    struct process_args *args = arg;
+
+    decoding_results_t *results = args->results;
+    struct key_state *ks = args->key_state;
+    int tid = args->id;
+
+    e_t e __attribute__((aligned(32)));
+    syndrome_t syndrome __attribute__((aligned(32)));
+
+    /* Error pattern */
+    index_t error_sparse[ERROR_WEIGHT];
+    /* Error pattern on the syndrome (for Ouroboros) */
+    index_t syndrome_error_sparse[ERROR_WEIGHT / 2];
+
+    qcmdpc_decoder_t dec = aligned_alloc(64, sizeof(*dec));
+    struct work w;
+    alloc_work(&w, results, tid);
+
+    struct PRNG prng;
+#if (ALGO == BP)
+    init_decoder(dec, &ks->key->H, &e, &syndrome);
+#else
+    init_decoder_key(dec, ks->key, &e, &syndrome);
+#endif
+    profile_start(&results->profile[tid]);
+
+    ++results->run;
+    while (1) {
+        if (tid == 0)
+            next_key(ks, results);
+        pthread_barrier_wait(&ks->barrier);
+        if (ks->index == -1)
+            break;
+        checkpoint_cross(results, tid, ks->n);
+
+        long int error;
+        while (results->run && (error = atomic_fetch_add(&ks->next_error, 1)) <
+                                   results->key_errors) {
+            long int index = ks->index * results->key_errors + error;
+            w.start = profile_clock();
+            init_instance_prng(&prng, results, STREAM_KEY_ERROR, index);
+            PROFILE_BEGIN(PROFILE_ERRORGEN);
+            double weight =
+                generate_error(error_sparse, &ks->key->H, results, &prng);
+            PROFILE_END(PROFILE_ERRORGEN);
+            decode_instance(dec, error_sparse, syndrome_error_sparse, weight,
+                            results, tid, &w, ks->index, index, &prng);
+            profile_instances(1);
+        }
+        pthread_barrier_wait(&ks->barrier);
+    }
+    if (results->run)
+        --results->run;
+    checkpoint_stop(results, tid, ks->partial ? 2 : 1);
+
+    profile_stop();
+    free_work(&w);
+    free(dec);
+
+    return NULL;
+}
+
+#if BATCH
+/* Decode the instances by batches of BATCH_LANES. The instances of a batch
+ * share the same parity check matrix, derived from the number of the first
+ * instance of the batch. */
+void *process_batch(void *arg) {
+    struct process_args *args = arg;
+
+    decoding_results_t *results = args->results;
+    int tid = args->id;
+
+    code_t H;
+
+    /* Error pattern */
+    index_t error_sparse[ERROR_WEIGHT];
+
+    /* Error patterns on the syndrome (for Ouroboros) */
+    index_t syndrome_error_sparse[BATCH_LANES][ERROR_WEIGHT / 2];
+
+    decoder_batch_t dec = aligned_alloc(32, sizeof(struct decoder_batch));
+
+    struct PRNG prng;
+    init_decoder_batch(dec, &H);
+    profile_start(&results->profile[tid]);
+
+    ++results->run;
+    long int indices[BATCH_LANES];
+    double weights[BATCH_LANES];
+    long int lanes;
+    long int n;
+    while (results->run &&
+           (lanes = next_instances(results, BATCH_LANES, indices, &n))) {
+        checkpoint_cross(results, tid, n);
+        PROFILE_BEGIN(PROFILE_KEYGEN);
+        init_instance_prng(&prng, results, STREAM_KEY, indices[0]);
+        generate_code(&H, &prng);
+        PROFILE_END(PROFILE_KEYGEN);
+
+        reset_decoder_batch(dec);
+        for (index_t b = 0; b < lanes; ++b) {
+            init_instance_prng(&prng, results, STREAM_INSTANCE, indices[b]);
+            PROFILE_BEGIN(PROFILE_ERRORGEN);
+            weights[b] = generate_error(error_sparse, &H, results, &prng);
+            PROFILE_END(PROFILE_ERRORGEN);
+            /* The error patterns are added to the syndromes directly. */
+            PROFILE_BEGIN(PROFILE_SYNDROME);
+            batch_add_error(dec, b, error_sparse);
+#if OUROBOROS
+            generate_random_syndrome_error(syndrome_error_sparse[b],
+                                           SYNDROME_STOP, &prng);
+            batch_add_syndrome_error(dec, b, syndrome_error_sparse[b],
+                                     SYNDROME_STOP);
+#endif
+            PROFILE_END(PROFILE_SYNDROME);
+        }
+
+        /* The batch decoder interleaves thresholds, counters and flips. */
+        PROFILE_BEGIN(PROFILE_FLIPS);
+        lane_mask_t success = qcmdpc_decode_batch(dec, results->max_iter);
+        PROFILE_END(PROFILE_FLIPS);
+        results_update_begin(results, tid);
+        for (index_t b = 0; b < lanes; ++b)
+            add_result(results, tid, success >> b & 1, dec->iter[b],
+                       weights[b]);
+        results_update_end(results, tid);
+        for (index_t b = 0; b < lanes; ++b)
+            capture_instance(results, tid, &H, -1, indices[b], dec->error[b],
+                             syndrome_error_sparse[b],
+                             (success >> b & 1) ? dec->iter[b] : -1,
+                             weights[b]);
+        profile_instances(lanes);
     }
     if (results->run)
         --results->run;
+    checkpoint_stop(results, tid, 1);
 
+    profile_stop();
     free(dec);
 
     return NULL;
 }
+#endif
 
-void decoder_loop(decoding_results_t *results, int n_threads, long int r) {
-    /* PRNG seeds */
-    uint64_t s[4] = {0};
-    seed_random(s);
+void decoder_loop(decoding_results_t *results, int n_threads) {
+    struct key_state ks;
+    if (results->key_errors > 0) {
+        ks.key = aligned_alloc(32, sizeof(key_data_t));
+#ifdef JIT
+        ks.jit = jit_alloc();
+        ks.key->jit = NULL;
+#endif
+        ks.index = -1;
+        ks.partial = 0;
+        atomic_init(&ks.next_error, 0);
+        long int n_test;
+        long int n_success;
+        ks.n_iter = malloc((results->max_iter + 1) * sizeof(long int));
+        sum_decoding_results(&n_test, &n_success, ks.n_iter, results);
+        ks.n_test = n_test;
+        ks.n_success = n_success;
+        pthread_barrier_init(&ks.barrier, NULL, n_threads);
+    }
 
     struct process_args args[n_threads];
     for (int i = 0; i < n_threads; i++) {
-        args[i].s[0] = s[0];
-        args[i].s[1] = s[1];
         args[i].id = i;
-
-        args[i].thread_iter = (r < 0) ? -1 : (i + r) / n_threads;
-
         args[i].results = results;
+        args[i].key_state = &ks;
     }
 
     pthread_t threads[n_threads];
 
-    for (int i = 0; i < n_threads; i++)
-        pthread_create(&threads[i], NULL, process, (void *)&args[i]);
+    /* Signals are handled by the other threads, a handler reading the results
+     * must not interrupt a thread updating them. */
+    sigset_t set;
+    sigset_t oldset;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, &oldset);
+
+    /* The pilot runs until the threads started, the campaign is not started
+     * if it was stopped during the pilot. */
+    int pilot = 0;
+    int started = n_threads;
+#if (ALGO != BP)
+    if (results->stratum_width) {
+        pilot = 1;
+        ++results->run;
+        free(results->stratum_rate);
+        stratum_pilot(results, n_threads);
+        if (!results->run)
+            started = 0;
+    }
+#endif
+
+    for (int i = 0; i < started; i++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (results->n_cpus)
+            affinity_set(&attr, results->cpus[i % results->n_cpus]);
+        if (results->key_errors > 0)
+            pthread_create(&threads[i], &attr, process_key, (void *)&args[i]);
+        else
+#if BATCH
+            pthread_create(&threads[i], &attr, process_batch,
+                           (void *)&args[i]);
+#else
+            pthread_create(&threads[i], &attr, process, (void *)&args[i]);
+#endif
+        pthread_attr_destroy(&attr);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
 
-    for (int i = 0; i < n_threads; i++)
+    for (int i = 0; i < started; i++)
         pthread_join(threads[i], NULL);
+    if (pilot && results->run)
+        --results->run;
+
+    if (results->key_errors > 0) {
+        pthread_barrier_destroy(&ks.barrier);
+        free(ks.n_iter);
+        free(ks.key);
+#ifdef JIT
+        jit_free(ks.jit);
+#endif
+    }
 }
 
 void decoder_stop(decoding_results_t *res) { res->run = 0; }
@@ -23,6 +23,7 @@
 #include <immintrin.h>
 #endif
 #include <stdlib.h>
+#include <string.h>
 
 #include "sparse_cyclic.h"
 
@@ -34,23 +35,54 @@ sparse_t sparse_new(index_t weight) {
 
 void sparse_free(sparse_t array) { free(array); }
 
+/* The searches below are branchless, the positions drawn at random would make
+ * the branches unpredictable. */
+
+/* Number of leading elements of 'array' (sorted, of length 'length') not
+ * greater than 'value'. */
+static inline index_t search_sorted(const index_t *array, index_t value,
+                                    index_t length) {
+    index_t lo = 0;
+    while (length > 1) {
+        index_t half = length / 2;
+        lo += (array[lo + half - 1] <= value) ? half : 0;
+        length -= half;
+    }
+    if (length)
+        lo += (array[lo] <= value);
+    return lo;
+}
+
+/* Number of leading elements 'array[i]' of 'array' (sorted, of length
+ * 'length') with at most 'value' positions that are not in the array below
+ * them. There are array[i] - i such positions, which does not decrease with
+ * i. */
+static inline index_t search_free(const index_t *array, index_t value,
+                                  index_t length) {
+    index_t lo = 0;
+    while (length > 1) {
+        index_t half = length / 2;
+        index_t i = lo + half - 1;
+        lo += (array[i] - i <= value) ? half : 0;
+        length -= half;
+    }
+    if (length)
+        lo += (array[lo] - lo <= value);
+    return lo;
+}
+
 /* Insert in place. */
 void insert_sorted_noinc(sparse_t array, index_t value, index_t max_i) {
-    index_t i;
-    for (i = 0; i < max_i && array[i] <= value; i++)
-        ;
-    for (index_t j = max_i; j > i; j--)
-        array[j] = array[j - 1];
+    index_t i = search_sorted(array, value, max_i);
+    memmove(array + i + 1, array + i, (max_i - i) * sizeof(index_t));
     array[i] = value;
 }
 
-/* Insert in place. */
+/* Insert in place the value-th position that is not in the array. */
 index_t insert_sorted(sparse_t array, index_t value, index_t max_i) {
-    index_t i;
-    for (i = 0; i < max_i && array[i] <= value; i++, value++)
-        ;
-    for (index_t j = max_i; j > i; j--)
-        array[j] = array[j - 1];
+    index_t i = search_free(array, value, max_i);
+    value += i;
+    memmove(array + i + 1, array + i, (max_i - i) * sizeof(index_t));
     array[i] = value;
     return value;
 }
@@ -60,7 +92,7 @@ index_t insert_sorted(sparse_t array, index_t value, index_t max_i) {
 void sparse_rand(sparse_t array, index_t weight, index_t length, prng_t prng) {
     /* Get an ordered list of positions for which the bit should be set to 1. */
     for (index_t i = 0; i < weight; i++) {
-        index_t rand = prng->random_lim(length--, prng->s);
+        index_t rand = random_lim(length--, prng->s);
         insert_sorted(array, rand, i);
     }
 }
@@ -0,0 +1,179 @@
+/*
+   Copyright (c) 2026 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+static const char magic[8] = "QCMDPCS";
+
+/* Give up reading a page still being updated after this number of attempts,
+ * 1 ms apart (its writer was killed during an update) */
+#define STATS_READ_ATTEMPTS 1000
+
+/* Page written by a simulation */
+struct stats {
+    struct stats_page *page;
+    size_t size;
+    /* Previous update, to compute the rates */
+    double elapsed;
+    long int *thread_test;
+};
+
+static size_t page_size(int n_threads, int max_iter) {
+    return sizeof(struct stats_page) + (max_iter + 1) * sizeof(int64_t) +
+           n_threads * (sizeof(int64_t) + sizeof(double));
+}
+
+/* Create the statistics page 'filename'. A previous file is unlinked first so
+ * that its readers keep their mapping. Returns NULL on failure. */
+struct stats *stats_open(const char *filename, const char *params,
+                         int n_threads, int max_iter, uint64_t seed) {
+    size_t size = page_size(n_threads, max_iter);
+    if (size > UINT32_MAX)
+        return NULL;
+
+    unlink(filename);
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return NULL;
+    if (ftruncate(fd, size)) {
+        close(fd);
+        return NULL;
+    }
+    struct stats_page *p =
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    struct stats *s = malloc(sizeof(struct stats));
+    s->page = p;
+    s->size = size;
+    s->elapsed = 0;
+    s->thread_test = calloc(n_threads, sizeof(long int));
+
+    /* The file was extended with zeros. */
+    p->version = STATS_VERSION;
+    p->size = size;
+    atomic_init(&p->seq, 0);
+    p->pid = getpid();
+    p->n_threads = n_threads;
+    p->max_iter = max_iter;
+    p->running = 1;
+    p->seed = seed;
+    snprintf(p->params, sizeof(p->params), "%s", params);
+    /* Readers ignore the page until its magic is set. */
+    atomic_thread_fence(memory_order_release);
+    memcpy(p->magic, magic, sizeof(p->magic));
+    return s;
+}
+
+/* Publish the results, 'thread_test' is the number of instances decoded by
+ * each thread and 'elapsed' the number of seconds since the start. */
+void stats_update(struct stats *s, double elapsed, long int n_test,
+                  long int n_success, const long int *n_iter,
+                  const long int *thread_test, int running) {
+    struct stats_page *p = s->page;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    double dt = elapsed - s->elapsed;
+
+    atomic_fetch_add_explicit(&p->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    p->running = running;
+    p->elapsed = elapsed;
+    p->updated = now.tv_sec + now.tv_nsec * 1e-9;
+    p->n_test = n_test;
+    p->n_success = n_success;
+    int64_t *iter = stats_n_iter(p);
+    for (int it = 0; it <= p->max_iter; ++it)
+        iter[it] = n_iter[it];
+    int64_t *test = stats_thread_test(p);
+    double *rate = stats_thread_rate(p);
+    for (int i = 0; i < p->n_threads; ++i) {
+        test[i] = thread_test[i];
+        rate[i] = (dt > 0) ? (thread_test[i] - s->thread_test[i]) / dt : 0;
+        s->thread_test[i] = thread_test[i];
+    }
+
+    atomic_fetch_add_explicit(&p->seq, 1, memory_order_release);
+    s->elapsed = elapsed;
+}
+
+/* Unmap the page, the file is kept with its last update. */
+void stats_close(struct stats *s) {
+    munmap(s->page, s->size);
+    free(s->thread_test);
+    free(s);
+}
+
+/* Consistent copy of the statistics page 'filename', to be freed. Returns
+ * NULL if the file is not a statistics page or could not be read. */
+struct stats_page *stats_read(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct stats_page)) {
+        close(fd);
+        return NULL;
+    }
+    struct stats_page *p =
+        mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    struct stats_page *copy = NULL;
+    size_t size = p->size;
+    if (!memcmp(p->magic, magic, sizeof(magic)) &&
+        p->version == STATS_VERSION && size <= (size_t)st.st_size &&
+        size == page_size(p->n_threads, p->max_iter)) {
+        copy = malloc(size);
+        int consistent = 0;
+        for (int i = 0; i < STATS_READ_ATTEMPTS && !consistent; ++i) {
+            unsigned seq = atomic_load_explicit(&p->seq, memory_order_acquire);
+            if (!(seq & 1)) {
+                memcpy(copy, p, size);
+                atomic_thread_fence(memory_order_acquire);
+                consistent = atomic_load_explicit(
+                                 &p->seq, memory_order_relaxed) == seq;
+            }
+            if (!consistent)
+                nanosleep(&(struct timespec){0, 1000000}, NULL);
+        }
+        if (!consistent) {
+            free(copy);
+            copy = NULL;
+        }
+    }
+    munmap(p, st.st_size);
+    return copy;
+}
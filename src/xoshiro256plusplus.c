@@ -7,6 +7,9 @@
 
    See <http://creativecommons.org/publicdomain/zero/1.0/>.
 */
+#ifdef AVX
+#include <immintrin.h>
+#endif
 #include <stdint.h>
 #include <stdio.h>
 
@@ -24,27 +27,6 @@
    fill s.
 */
 
-static inline uint64_t rotl(const uint64_t x, int k) {
-    return (x << k) | (x >> (64 - k));
-}
-
-uint64_t random_uint64_t(uint64_t *s) {
-    const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
-
-    const uint64_t t = s[1] << 17;
-
-    s[2] ^= s[0];
-    s[3] ^= s[1];
-    s[1] ^= s[2];
-    s[0] ^= s[3];
-
-    s[2] ^= t;
-
-    s[3] = rotl(s[3], 45);
-
-    return result;
-}
-
 int seed_random(uint64_t *s) {
     FILE *urandom_fp;
 
@@ -58,24 +40,6 @@ int seed_random(uint64_t *s) {
     return 1;
 }
 
-/* See
- * <https://lemire.me/blog/2019/06/06/nearly-divisionless-random-integer-generation-on-various-systems/>.
- */
-uint64_t random_lim(uint64_t limit, uint64_t *s) {
-    uint64_t x = random_uint64_t(s);
-    __uint128_t m = (__uint128_t)x * (__uint128_t)limit;
-    uint64_t l = (uint64_t)m;
-    if (l < limit) {
-        uint64_t t = -limit % limit;
-        while (l < t) {
-            x = random_uint64_t(s);
-            m = (__uint128_t)x * (__uint128_t)limit;
-            l = (uint64_t)m;
-        }
-    }
-    return m >> 64;
-}
-
 /* This is the jump function for the generator. It is equivalent to 2^128 calls
  * to next(); it can be used to generate 2^128 non-overlapping subsequences for
  * parallel computations. */
@@ -103,3 +67,163 @@ void jump(uint64_t *s) {
     s[2] = s2;
     s[3] = s3;
 }
+
+/* splitmix64 output function */
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+/* Seed 's' from a global seed, a stream and the index of an instance. The
+ * state is made of the outputs 4 * index to 4 * index + 3 of the splitmix64
+ * generator of this seed and stream, so that the state of any instance can be
+ * computed directly and distinct instances have distinct states. */
+void seed_instance(uint64_t *s, uint64_t seed, uint64_t stream,
+                   uint64_t index) {
+    const uint64_t gamma = 0x9e3779b97f4a7c15;
+    uint64_t x = (seed ^ mix64((stream + 1) * gamma)) + 4 * index * gamma;
+    for (int i = 0; i < 4; ++i) {
+        x += gamma;
+        s[i] = mix64(x);
+    }
+    /* The state must not be everywhere zero. */
+    if (!(s[0] | s[1] | s[2] | s[3]))
+        s[0] = 1;
+}
+
+void prng_lanes_seed(struct prng_lanes *p, prng_t prng) {
+    for (int i = 0; i < PRNG_LANES; ++i) {
+        for (int w = 0; w < 4; ++w)
+            p->s[w][i] = random_uint64_t(prng->s);
+        /* The state of a lane must not be everywhere zero. */
+        if (!(p->s[0][i] | p->s[1][i] | p->s[2][i] | p->s[3][i]))
+            p->s[0][i] = 1;
+    }
+}
+
+#if defined(AVX) && defined(__AVX512F__)
+void prng_lanes_fill(struct prng_lanes *p, uint64_t *out, size_t n) {
+    __m512i s0 = _mm512_load_si512(p->s[0]);
+    __m512i s1 = _mm512_load_si512(p->s[1]);
+    __m512i s2 = _mm512_load_si512(p->s[2]);
+    __m512i s3 = _mm512_load_si512(p->s[3]);
+    for (size_t j = 0; j < n; j += PRNG_LANES) {
+        __m512i result = _mm512_add_epi64(
+            _mm512_rol_epi64(_mm512_add_epi64(s0, s3), 23), s0);
+        _mm512_storeu_si512(out + j, result);
+        __m512i t = _mm512_slli_epi64(s1, 17);
+        s2 = _mm512_xor_si512(s2, s0);
+        s3 = _mm512_xor_si512(s3, s1);
+        s1 = _mm512_xor_si512(s1, s2);
+        s0 = _mm512_xor_si512(s0, s3);
+        s2 = _mm512_xor_si512(s2, t);
+        s3 = _mm512_rol_epi64(s3, 45);
+    }
+    _mm512_store_si512(p->s[0], s0);
+    _mm512_store_si512(p->s[1], s1);
+    _mm512_store_si512(p->s[2], s2);
+    _mm512_store_si512(p->s[3], s3);
+}
+#elif defined(AVX)
+static inline __m256i rotl_avx2(__m256i x, int k) {
+    return _mm256_or_si256(_mm256_slli_epi64(x, k),
+                           _mm256_srli_epi64(x, 64 - k));
+}
+
+void prng_lanes_fill(struct prng_lanes *p, uint64_t *out, size_t n) {
+    /* Two vectors of 4 lanes */
+    __m256i s[4][2];
+    for (int w = 0; w < 4; ++w)
+        for (int h = 0; h < 2; ++h)
+            s[w][h] = _mm256_load_si256((__m256i *)(p->s[w] + 4 * h));
+    for (size_t j = 0; j < n; j += PRNG_LANES) {
+        for (int h = 0; h < 2; ++h) {
+            __m256i result = _mm256_add_epi64(
+                rotl_avx2(_mm256_add_epi64(s[0][h], s[3][h]), 23), s[0][h]);
+            _mm256_storeu_si256((__m256i *)(out + j + 4 * h), result);
+            __m256i t = _mm256_slli_epi64(s[1][h], 17);
+            s[2][h] = _mm256_xor_si256(s[2][h], s[0][h]);
+            s[3][h] = _mm256_xor_si256(s[3][h], s[1][h]);
+            s[1][h] = _mm256_xor_si256(s[1][h], s[2][h]);
+            s[0][h] = _mm256_xor_si256(s[0][h], s[3][h]);
+            s[2][h] = _mm256_xor_si256(s[2][h], t);
+            s[3][h] = rotl_avx2(s[3][h], 45);
+        }
+    }
+    for (int w = 0; w < 4; ++w)
+        for (int h = 0; h < 2; ++h)
+            _mm256_store_si256((__m256i *)(p->s[w] + 4 * h), s[w][h]);
+}
+#else
+void prng_lanes_fill(struct prng_lanes *p, uint64_t *out, size_t n) {
+    uint64_t(*s)[PRNG_LANES] = p->s;
+    for (size_t j = 0; j < n; j += PRNG_LANES) {
+        for (int i = 0; i < PRNG_LANES; ++i) {
+            out[j + i] = xoshiro_rotl(s[0][i] + s[3][i], 23) + s[0][i];
+            const uint64_t t = s[1][i] << 17;
+            s[2][i] ^= s[0][i];
+            s[3][i] ^= s[1][i];
+            s[1][i] ^= s[2][i];
+            s[0][i] ^= s[3][i];
+            s[2][i] ^= t;
+            s[3][i] = xoshiro_rotl(s[3][i], 45);
+        }
+    }
+}
+#endif
+
+/* Number of outputs of the lanes drawn at once by prng_lanes_lim() */
+#define LANES_BLOCK (8 * PRNG_LANES)
+
+/* Keep the 32-bit draws of word 'x' (low half first) that are not rejected,
+ * until 'n' values are stored in 'out'. */
+static inline size_t lim_word(uint64_t x, uint32_t limit, uint32_t t,
+                              uint32_t *out, size_t k, size_t n) {
+    for (int h = 0; h < 2 && k < n; ++h, x >>= 32) {
+        uint64_t m = (x & 0xffffffff) * limit;
+        if ((uint32_t)m >= t)
+            out[k++] = m >> 32;
+    }
+    return k;
+}
+
+void prng_lanes_lim(struct prng_lanes *p, uint32_t limit, uint32_t *out,
+                    size_t n) {
+    uint64_t raw[LANES_BLOCK] __attribute__((aligned(32)));
+    /* Rejection threshold, computed once for all the draws */
+    const uint32_t t = -limit % limit;
+    size_t k = 0;
+    while (k < n) {
+        prng_lanes_fill(p, raw, LANES_BLOCK);
+        size_t w = 0;
+#ifdef AVX
+        const __m256i lim = _mm256_set1_epi64x(limit);
+        const __m256i threshold = _mm256_set1_epi32(t);
+        /* 4 words give 8 draws, stored at once when none is rejected (the
+         * threshold is small compared to 2^32 so this is the common case).
+         * Otherwise, the words are handled one by one as below. */
+        for (; w < LANES_BLOCK && k + 8 <= n; w += 4) {
+            __m256i x = _mm256_load_si256((__m256i *)(raw + w));
+            __m256i lo = _mm256_mul_epu32(x, lim);
+            __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), lim);
+            __m256i low = _mm256_blend_epi32(lo, _mm256_slli_epi64(hi, 32),
+                                             0xaa);
+            __m256i ok = _mm256_cmpeq_epi32(
+                _mm256_max_epu32(low, threshold), low);
+            if (_mm256_movemask_epi8(ok) == -1) {
+                _mm256_storeu_si256(
+                    (__m256i *)(out + k),
+                    _mm256_blend_epi32(_mm256_srli_epi64(lo, 32), hi, 0xaa));
+                k += 8;
+            }
+            else {
+                for (int i = 0; i < 4; ++i)
+                    k = lim_word(raw[w + i], limit, t, out, k, n);
+            }
+        }
+#endif
+        for (; w < LANES_BLOCK && k < n; ++w)
+            k = lim_word(raw[w], limit, t, out, k, n);
+    }
+}